@@ -1,32 +1,62 @@
 #include "assembler.h"
+#include "mapped_file.h"
+#include "optimizer.h"
 
 #include <cctype>
+#include <cstring>
 #include <limits>
-#include <sstream>
+
+CompilationOptions::CompilationOptions()
+    : fuse_instructions{true}, optimize{false}, native_code{false} { }
 
 namespace computer_internal {
 Assembler::Assembler() { }
 
-void Assembler::Parser::require(bool condition, const std::string &why) const {
+constexpr Assembler::Mnemonic Assembler::MNEMONICS[];
+
+constexpr bool Assembler::perfectHash(std::size_t slot) {
+    return slot == MNEMONIC_SLOTS
+        || ((MNEMONICS[slot].length == 0
+             || mnemonicHash(MNEMONICS[slot].name,
+                             MNEMONICS[slot].length) == slot)
+            && perfectHash(slot + 1));
+}
+
+std::string Assembler::Token::str() const {
+    return std::string(data, length);
+}
+
+const Assembler::Mnemonic* Assembler::findMnemonic(const Token &word) {
+    static_assert(perfectHash(), "The mnemonics are not placed by their hash");
+
+    const Mnemonic &candidate = MNEMONICS[mnemonicHash(word.data, word.length)];
+    if(candidate.length != word.length
+            || std::memcmp(candidate.name, word.data, word.length) != 0)
+        return nullptr;
+    return &candidate;
+}
+
+void Assembler::Parser::require(bool condition, const char *why) const {
     if(!condition)
-        throw ParserException(why, line, pos);
+        fail(why);
 }
 
-void Assembler::Parser::removeTrailingDOSEndline() {
-    if(!line.empty() && line.back() == '\r')
-        line.pop_back();
+void Assembler::Parser::fail(const std::string &why) const {
+    throw ParserException(why, std::string(line, length), pos);
 }
 
-Assembler::Parser::Parser(const std::string &line) : line{line}, pos{0} { 
-    removeTrailingDOSEndline();
+void Assembler::Parser::removeTrailingDOSEndline() {
+    if(length > 0 && line[length - 1] == '\r')
+        --length;
 }
 
-Assembler::Parser::Parser(std::string &&line) : line{std::move(line)}, pos{0} {
+Assembler::Parser::Parser(const char *begin, const char *end)
+    : line{begin}, length{static_cast<pos_type>(end - begin)}, pos{0} {
     removeTrailingDOSEndline();
 }
 
 bool Assembler::Parser::hasNext() const {
-    return line.size() > pos;
+    return length > pos;
 }
 
 char Assembler::Parser::getNext() {
@@ -35,7 +65,7 @@ char Assembler::Parser::getNext() {
 }
 
 void Assembler::Parser::skipSpaces() {
-    while(pos < line.size() && std::isspace(line[pos]))
+    while(pos < length && std::isspace(line[pos]))
         ++pos;
 }
 
@@ -60,7 +90,8 @@ T Assembler::Parser::parseIntegral() {
             continue;
         }
 
-        require(isdigit(c), std::string{"Expected a digit, got "} + c);
+        if(!isdigit(c))
+            fail(std::string{"Expected a digit, got "} + c);
         res = res * 10 + (c - '0');
     }
 
@@ -94,91 +125,190 @@ number_type Assembler::Parser::parseNumber() {
     return parseIntegral<number_type>();
 }
 
+Assembler::Token Assembler::Parser::parseLabel() {
+    Token label = getWord();
+    require(label.length > 0, "Expected a label");
+    requireLabel(label);
+    return label;
+}
+
+void Assembler::Parser::requireLabel(const Token &word) const {
+    bool valid = word.length > 0
+        && (std::isalpha(word.data[0]) || word.data[0] == '_');
+    for(std::size_t i = 1; valid && i < word.length; ++i)
+        valid = std::isalnum(word.data[i]) || word.data[i] == '_';
+    if(!valid)
+        invalidLabel(word, "Invalid label");
+}
+
+void Assembler::Parser::invalidLabel(const Token &label,
+                                     const char *why) const {
+    fail(why + (" " + label.str()));
+}
+
 void Assembler::Parser::end() {
     skipSpaces();
-    require(pos == line.size(), "Trailing characters");
+    require(pos == length, "Trailing characters");
 }
 
-std::string Assembler::Parser::getWord() {
-    // Type disambiguation wrapper
+Assembler::Token Assembler::Parser::getWord() {
     skipSpaces();
-    auto isspace = [](char c) { return std::isspace(c); };
-    auto it = std::find_if(line.begin() + pos, line.end(), isspace);
-    auto next_space = it - line.begin();
-
-    std::string result = line.substr(pos, next_space - pos);
-    pos = next_space;
-    return result;
-}
-
-std::shared_ptr<const Instruction> Assembler::compileLine(std::string &&line) {
-    Parser parser{std::move(line)};
-    std::string op = parser.getWord();
-    if(op == "SET") {
-        auto reg = parser.parseRegister();
-        auto val = parser.parseNumber();
-        parser.end();
-        return std::make_shared<const SetInstruction>(reg, val);
-    }
-    else if(op == "LOAD") {
-        auto reg = parser.parseRegister();
-        auto mem = parser.parseAddress();
-        parser.end();
-        return std::make_shared<const LoadInstruction>(reg, mem);
-    }
-    else if(op == "STORE") {
-        auto mem = parser.parseAddress();
-        auto reg = parser.parseRegister();
-        parser.end();
-        return std::make_shared<const StoreInstruction>(mem, reg);
-    }
-    else if(op == "ADD") {
-        auto lhs = parser.parseRegister();
-        auto rhs = parser.parseRegister();
-        parser.end();
-        return std::make_shared<const AddInstruction>(lhs, rhs);
+    pos_type start = pos;
+    while(pos < length && !std::isspace(line[pos]))
+        ++pos;
+    return {line + start, pos - start};
+}
+
+void Assembler::compileLine(const char *begin, const char *end,
+                            Program &program, Labels &labels) {
+    Parser parser{begin, end};
+    Token op = parser.getWord();
+
+    while(op.length > 0 && op.data[op.length - 1] == ':') {
+        Token label{op.data, op.length - 1};
+        parser.requireLabel(label);
+        // The targets are stored as operands
+        if(program.size() > static_cast<Program::size_type>(
+                std::numeric_limits<code_type>::max()))
+            parser.invalidLabel(label, "Unreachable label");
+        code_type target = static_cast<code_type>(program.size());
+        if(!labels.defined.emplace(label.str(), target).second)
+            parser.invalidLabel(label, "Duplicate label");
+        op = parser.getWord();
     }
-    else if(op == "SUB") {
-        auto lhs = parser.parseRegister();
-        auto rhs = parser.parseRegister();
-        parser.end();
-        return std::make_shared<const SubInstruction>(lhs, rhs);
+
+    if(op.length == 0) // empty line (except for whitespace and labels)
+        return;
+
+    const Mnemonic *mnemonic = findMnemonic(op);
+    if(!mnemonic)
+        throw UnknownInstructionException(op.str());
+
+    code_type first;
+    code_type second = 0;
+    Token label{nullptr, 0};
+    switch(mnemonic->syntax) {
+        case Syntax::REGISTER_NUMBER:
+            first = parser.parseRegister();
+            second = parser.parseNumber();
+            break;
+        case Syntax::REGISTER_ADDRESS:
+            first = parser.parseRegister();
+            second = parser.parseAddress();
+            break;
+        case Syntax::ADDRESS_REGISTER:
+            first = parser.parseAddress();
+            second = parser.parseRegister();
+            break;
+        case Syntax::REGISTER_REGISTER:
+            first = parser.parseRegister();
+            second = parser.parseRegister();
+            break;
+        case Syntax::LABEL:
+            first = 0;
+            label = parser.parseLabel();
+            break;
+        case Syntax::REGISTER_LABEL:
+            first = parser.parseRegister();
+            label = parser.parseLabel();
+            break;
+        default: // REGISTER
+            first = parser.parseRegister();
+            break;
     }
-    else if(op == "MUL") {
-        auto lhs = parser.parseRegister();
-        auto rhs = parser.parseRegister();
-        parser.end();
-        return std::make_shared<const MulInstruction>(lhs, rhs);
+
+    parser.end();
+    program.push_back({mnemonic->opcode, first, second});
+
+    if(label.length > 0) {
+        auto defined = labels.defined.find(label.str());
+        if(defined != labels.defined.end())
+            jumpTarget(program.back()) = defined->second;
+        else
+            labels.unresolved.emplace_back(program.size() - 1, label.str());
     }
-    else if(op == "DIV") {
-        auto lhs = parser.parseRegister();
-        auto rhs = parser.parseRegister();
-        parser.end();
-        return std::make_shared<const DivInstruction>(lhs, rhs);
+}
+
+void Assembler::resolveLabels(Program &program, const Labels &labels) {
+    for(const auto &jump : labels.unresolved) {
+        auto defined = labels.defined.find(jump.second);
+        if(defined == labels.defined.end())
+            throw UndefinedLabelException(jump.second);
+        jumpTarget(program[jump.first]) = defined->second;
     }
-    else if(op == "PRINTLN") {
-        auto reg = parser.parseRegister();
-        parser.end();
-        return std::make_shared<const PrintlnInstruction>(reg);
+}
+
+Opcode Assembler::superinstruction(Opcode first, Opcode arithmetic) {
+    bool set = first == Opcode::SET;
+    switch(arithmetic) {
+        case Opcode::ADD:
+            return set ? Opcode::SET_ADD : Opcode::LOAD_ADD_STORE;
+        case Opcode::SUB:
+            return set ? Opcode::SET_SUB : Opcode::LOAD_SUB_STORE;
+        case Opcode::MUL:
+            return set ? Opcode::SET_MUL : Opcode::LOAD_MUL_STORE;
+        case Opcode::DIV:
+            return set ? Opcode::SET_DIV : Opcode::LOAD_DIV_STORE;
+        default:
+            return first;
     }
-    else if(op == "") { // empty line (except for whitespace)
-        return {};
+}
+
+void Assembler::fuse(Program &program) {
+    auto size = program.size();
+    for(Program::size_type i = 0; i < size; ) {
+        Opcode fused = program[i].opcode;
+        bool pair = i + 1 < size;
+        bool triple = i + 2 < size;
+
+        if(pair && fused == Opcode::SET)
+            fused = superinstruction(fused, program[i + 1].opcode);
+        else if(triple && fused == Opcode::LOAD
+                && program[i + 2].opcode == Opcode::STORE)
+            fused = superinstruction(fused, program[i + 1].opcode);
+
+        program[i].opcode = fused;
+        i += fusedLength(fused);
     }
-    else
-        throw UnknownInstructionException(op);
 }
 
-std::shared_ptr<Program> Assembler::compile(const std::string &code) {
-    std::istringstream stream{code};
-    std::string line;
+std::shared_ptr<Program> Assembler::compile(const std::string &code,
+                                            const CompilationOptions &options,
+                                            const MachineLimits *machine) {
+    return compile(code.data(), code.size(), options, machine);
+}
+
+std::shared_ptr<Program> Assembler::compileFile(const std::string &path,
+        const CompilationOptions &options,
+        const MachineLimits *machine) {
+    MappedFile file{path};
+    return compile(file.data(), file.size(), options, machine);
+}
+
+std::shared_ptr<Program> Assembler::compile(const char *code, std::size_t size,
+                                            const CompilationOptions &options,
+                                            const MachineLimits *machine) {
     auto compiled = std::make_shared<Program>();
+    const char *end = code + size;
+    Labels labels;
 
-    while(std::getline(stream, line)) {
-        auto instruction = compileLine(std::move(line));
-        if(instruction)
-            compiled->push_back(instruction);
+    while(code != end) {
+        auto newline = static_cast<const char*>(
+            std::memchr(code, '\n', end - code));
+        const char *line_end = newline ? newline : end;
+        compileLine(code, line_end, *compiled, labels);
+        code = newline ? newline + 1 : end;
     }
+    resolveLabels(*compiled, labels);
+
+    if(options.optimize && machine)
+        Optimizer::optimize(*compiled, *machine);
+
+    if(options.fuse_instructions)
+        fuse(*compiled);
 
+    // The image is immutable from now on
+    compiled->shrink_to_fit();
     return compiled;
 }
 } // namespace computer_internal
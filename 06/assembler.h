@@ -3,30 +3,117 @@
 
 #include <memory>
 #include <string>
-#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include "common.h"
 #include "instruction.h"
 #include "process.h"
 
+// Optional passes performed by the assembler
+struct CompilationOptions {
+    // Replace common instruction sequences with superinstructions. It does
+    // not change the semantics of programs (including the timing and the
+    // exceptions thrown), only the speed of their execution.
+    bool fuse_instructions;
+
+    // Run the dataflow optimizer (constant folding, forwarding of stored
+    // values, dead write elimination). The output and the exceptions are
+    // preserved, but the optimized program is shorter, so it may be
+    // scheduled differently by SJF. Requires the machine the program is
+    // compiled for to be known, and is ignored by the OS unless the
+    // processes run one at a time (see OS::setCompilationOptions).
+    bool optimize;
+
+    // Translate the leading straight-line part of the programs into the
+    // machine code of the host, which runs it without the interpretive
+    // dispatch. The output, the timing and the exceptions are the same.
+    // Only supported on x86-64 Linux, ignored elsewhere.
+    bool native_code;
+
+    CompilationOptions();
+};
+
 namespace computer_internal {
 class Assembler {
     private:
     Assembler(); // Singleton class
 
+    // A range of characters of the source code. The source is never copied
+    // while it is parsed.
+    struct Token {
+        const char *data;
+        std::size_t length;
+
+        std::string str() const;
+    };
+
+    // The operands of an instruction, in the order of the source code
+    enum class Syntax {
+        REGISTER_NUMBER, REGISTER_ADDRESS, ADDRESS_REGISTER,
+        REGISTER_REGISTER, REGISTER, LABEL, REGISTER_LABEL
+    };
+
+    struct Mnemonic {
+        const char *name;
+        std::size_t length;
+        Opcode opcode;
+        Syntax syntax;
+    };
+
+    // The mnemonics are placed in the table by a perfect hash of the first,
+    // the middle and the last character and the length, so that looking one
+    // up takes a single comparison
+    static constexpr std::size_t MNEMONIC_SLOTS = 16;
+    static constexpr std::size_t mnemonicHash(const char *word,
+                                              std::size_t length) {
+        return (6 * static_cast<unsigned char>(word[0])
+            + 5 * static_cast<unsigned char>(word[length / 2])
+            + 7 * static_cast<unsigned char>(word[length - 1])
+            + length) % MNEMONIC_SLOTS;
+    }
+
+    // Indexed by the hash, the empty slots have no name
+    static constexpr Mnemonic MNEMONICS[MNEMONIC_SLOTS] = {
+        {"JMP", 3, Opcode::JMP, Syntax::LABEL},
+        {"JLZ", 3, Opcode::JLZ, Syntax::REGISTER_LABEL},
+        {"DIV", 3, Opcode::DIV, Syntax::REGISTER_REGISTER},
+        {"", 0, Opcode::SET, Syntax::REGISTER},
+        {"", 0, Opcode::SET, Syntax::REGISTER},
+        {"STORE", 5, Opcode::STORE, Syntax::ADDRESS_REGISTER},
+        {"JZ", 2, Opcode::JZ, Syntax::REGISTER_LABEL},
+        {"", 0, Opcode::SET, Syntax::REGISTER},
+        {"JGZ", 3, Opcode::JGZ, Syntax::REGISTER_LABEL},
+        {"ADD", 3, Opcode::ADD, Syntax::REGISTER_REGISTER},
+        {"SET", 3, Opcode::SET, Syntax::REGISTER_NUMBER},
+        {"JNZ", 3, Opcode::JNZ, Syntax::REGISTER_LABEL},
+        {"SUB", 3, Opcode::SUB, Syntax::REGISTER_REGISTER},
+        {"LOAD", 4, Opcode::LOAD, Syntax::REGISTER_ADDRESS},
+        {"MUL", 3, Opcode::MUL, Syntax::REGISTER_REGISTER},
+        {"PRINTLN", 7, Opcode::PRINTLN, Syntax::REGISTER},
+    };
+    // Whether every mnemonic is placed in the slot it hashes to
+    static constexpr bool perfectHash(std::size_t slot = 0);
+
+    // The mnemonic spelled by the (non-empty) word, or null if there is none
+    static const Mnemonic* findMnemonic(const Token &word);
+
     class Parser {
         using pos_type = std::string::size_type;
 
         private:
-        std::string line;
+        const char *line;
+        pos_type length;
         pos_type pos;
 
-        void require(bool condition, const std::string &why) const;
+        // The message is only built when the condition does not hold
+        void require(bool condition, const char *why) const;
+        [[noreturn]] void fail(const std::string &why) const;
         void removeTrailingDOSEndline();
         void skipSpaces();
 
         public:
-        Parser(const std::string &line);
-        Parser(std::string &&line);
+        Parser(const char *begin, const char *end);
         bool hasNext() const;
         char getNext();
 
@@ -36,13 +123,49 @@ class Assembler {
         register_type parseRegister();
         memory_type parseAddress();
         number_type parseNumber();
+        Token parseLabel();
         void end();
-        std::string getWord();
+        Token getWord();
+        // Fails if the word is not a valid label name
+        void requireLabel(const Token &word) const;
+        [[noreturn]] void invalidLabel(const Token &label,
+                                       const char *why) const;
+    };
+
+    // The labels of the program being assembled. A label stands for the
+    // index of the instruction following it.
+    struct Labels {
+        std::unordered_map<std::string, code_type> defined;
+        // The jumps to the labels not defined yet: the index of the jump
+        // and the label
+        std::vector<std::pair<Program::size_type, std::string>> unresolved;
     };
 
-    static std::shared_ptr<const Instruction> compileLine(std::string &&line);
+    // Appends the instruction (if any) on the line to the program image,
+    // the line may start with labels. The jumps backwards are resolved at
+    // once, the others once the whole program is read.
+    static void compileLine(const char *begin, const char *end,
+                            Program &program, Labels &labels);
+    static void resolveLabels(Program &program, const Labels &labels);
+
+    // Fuses the sequences of instructions into superinstructions
+    static void fuse(Program &program);
+    // The superinstruction made of SET or LOAD (followed by STORE) and the
+    // arithmetic instruction, or the first opcode if there is none
+    static Opcode superinstruction(Opcode first, Opcode arithmetic);
+
     public:
-    static std::shared_ptr<Program> compile(const std::string &code);
+    // The machine is only needed by the optimizer
+    static std::shared_ptr<Program> compile(const std::string &code,
+            const CompilationOptions &options = CompilationOptions{},
+            const MachineLimits *machine = nullptr);
+    static std::shared_ptr<Program> compile(const char *code, std::size_t size,
+            const CompilationOptions &options = CompilationOptions{},
+            const MachineLimits *machine = nullptr);
+    // Assembles the source code straight from the memory-mapped file
+    static std::shared_ptr<Program> compileFile(const std::string &path,
+            const CompilationOptions &options = CompilationOptions{},
+            const MachineLimits *machine = nullptr);
 };
 } // namespace computer_internal
 
@@ -0,0 +1,365 @@
+#include "batch.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+using namespace computer_internal;
+
+namespace {
+// The value of the lanes taking part, the old one of the other ones
+inline number_type blend(number_type value, number_type old, number_type mask) {
+    return (value & mask) | (old & ~mask);
+}
+
+// The arithmetic wraps around, just like the truncated 64-bit arithmetic of
+// the interpreter, but in 32 bits, so that more lanes fit in a vector
+template<class Op>
+void arithmetic(number_type *destination, const number_type *source,
+                const number_type *mask, std::size_t lanes) {
+    Op operation;
+    for(std::size_t i = 0; i < lanes; ++i) {
+        auto value = operation(static_cast<uint32_t>(destination[i]),
+                               static_cast<uint32_t>(source[i]));
+        destination[i] = blend(static_cast<number_type>(value),
+                               destination[i], mask[i]);
+    }
+}
+
+template<class Compare>
+std::size_t compare(const number_type *values, const number_type *mask,
+                    number_type *result, std::size_t lanes) {
+    Compare condition;
+    std::size_t count = 0;
+    for(std::size_t i = 0; i < lanes; ++i) {
+        result[i] = mask[i] & -static_cast<number_type>(condition(values[i], 0));
+        count += result[i] & 1;
+    }
+    return count;
+}
+} // namespace
+
+namespace computer_internal {
+constexpr const std::size_t LaneMemory::PAGE_ROWS;
+
+LaneMemory::LaneMemory(number_type rows, std::size_t lanes)
+    : rows{rows}, width{lanes} {
+    if(rows <= 0)
+        throw IllegalArgumentException("Negative size provided");
+    pages.resize((static_cast<std::size_t>(rows) + PAGE_ROWS - 1) / PAGE_ROWS);
+}
+
+const number_type* LaneMemory::row(number_type index) const {
+    auto position = static_cast<std::size_t>(index);
+    const auto &page = pages[position / PAGE_ROWS];
+    return page ? &page[position % PAGE_ROWS * width] : nullptr;
+}
+
+number_type* LaneMemory::writableRow(number_type index) {
+    auto position = static_cast<std::size_t>(index);
+    auto &page = pages[position / PAGE_ROWS];
+    if(!page)
+        page.reset(new number_type[PAGE_ROWS * width]());
+    return &page[position % PAGE_ROWS * width];
+}
+
+number_type LaneMemory::size() const {
+    return rows;
+}
+
+std::size_t LaneMemory::lanes() const {
+    return width;
+}
+} // namespace computer_internal
+
+ComputerBatch::ComputerBatch(register_type registers, memory_type memory,
+                             std::size_t lanes)
+    : register_count{registers}
+    , lanes{lanes}
+    , ram{memory, lanes}
+    , output{StreamOutput::standard()} {
+    if(registers <= 0)
+        throw IllegalArgumentException("Negative size provided");
+    if(lanes == 0)
+        throw IllegalArgumentException("No lanes requested");
+    this->registers.resize(static_cast<std::size_t>(registers) * lanes);
+}
+
+number_type* ComputerBatch::registerRow(register_type reg) {
+    return &registers[static_cast<std::size_t>(reg - 1) * lanes];
+}
+
+void ComputerBatch::checkLane(std::size_t lane) const {
+    if(lane >= lanes)
+        throw IllegalArgumentException("Lane out of range");
+}
+
+std::size_t ComputerBatch::size() const {
+    return lanes;
+}
+
+void ComputerBatch::setCompilationOptions(const CompilationOptions &options) {
+    this->options = options;
+}
+
+void ComputerBatch::setOutput(std::shared_ptr<OutputSink> sink) {
+    output = sink;
+}
+
+void ComputerBatch::store(std::size_t lane, memory_type address,
+                          number_type value) {
+    checkLane(lane);
+    if(address < 0 || address >= ram.size())
+        throw InvalidAddressException(address);
+    ram.writableRow(address)[lane] = value;
+}
+
+number_type ComputerBatch::load(std::size_t lane, memory_type address) const {
+    checkLane(lane);
+    if(address < 0 || address >= ram.size())
+        throw InvalidAddressException(address);
+    const number_type *row = ram.row(address);
+    return row ? row[lane] : 0;
+}
+
+std::exception_ptr ComputerBatch::fault(const Operation &operation,
+                                        const MachineLimits &machine) {
+    code_type first = operation.first;
+    code_type second = operation.second;
+
+    // In the order the interpreter accesses the operands
+    try {
+        switch(baseOpcode(operation.opcode)) {
+            case Opcode::LOAD:
+                if(!machine.validAddress(second))
+                    throw InvalidAddressException(second);
+                if(!machine.validRegister(first))
+                    throw InvalidRegisterException(first);
+                break;
+            case Opcode::STORE:
+                if(!machine.validRegister(second))
+                    throw InvalidRegisterException(second);
+                if(!machine.validAddress(first))
+                    throw InvalidAddressException(first);
+                break;
+            case Opcode::ADD:
+            case Opcode::SUB:
+            case Opcode::MUL:
+            case Opcode::DIV:
+                if(!machine.validRegister(second))
+                    throw InvalidRegisterException(second);
+                if(!machine.validRegister(first))
+                    throw InvalidRegisterException(first);
+                break;
+            case Opcode::JMP:
+                break;
+            default: // SET, PRINTLN and the conditional jumps
+                if(!machine.validRegister(first))
+                    throw InvalidRegisterException(first);
+                break;
+        }
+    }
+    catch(...) {
+        return std::current_exception();
+    }
+
+    return nullptr;
+}
+
+std::size_t ComputerBatch::execute(const Operation &operation, Mask &mask,
+                                   Mask &running,
+                                   std::vector<std::exception_ptr> &errors) {
+    const number_type *active = mask.data();
+    std::size_t faulted = 0;
+    auto stop = [&mask, &running, &errors, &faulted](std::size_t lane) {
+        errors[lane] = std::current_exception();
+        mask[lane] = running[lane] = 0;
+        ++faulted;
+    };
+
+    switch(baseOpcode(operation.opcode)) {
+        case Opcode::SET: {
+            number_type *destination = registerRow(operation.first);
+            for(std::size_t i = 0; i < lanes; ++i)
+                destination[i] = blend(operation.second, destination[i],
+                                       active[i]);
+            break;
+        }
+        case Opcode::LOAD: {
+            number_type *destination = registerRow(operation.first);
+            const number_type *source = ram.row(operation.second);
+            if(source)
+                for(std::size_t i = 0; i < lanes; ++i)
+                    destination[i] = blend(source[i], destination[i],
+                                           active[i]);
+            else
+                for(std::size_t i = 0; i < lanes; ++i)
+                    destination[i] &= ~active[i];
+            break;
+        }
+        case Opcode::STORE: {
+            number_type *destination = ram.writableRow(operation.first);
+            const number_type *source = registerRow(operation.second);
+            for(std::size_t i = 0; i < lanes; ++i)
+                destination[i] = blend(source[i], destination[i], active[i]);
+            break;
+        }
+        case Opcode::ADD:
+            arithmetic<std::plus<uint32_t>>(registerRow(operation.first),
+                registerRow(operation.second), active, lanes);
+            break;
+        case Opcode::SUB:
+            arithmetic<std::minus<uint32_t>>(registerRow(operation.first),
+                registerRow(operation.second), active, lanes);
+            break;
+        case Opcode::MUL:
+            arithmetic<std::multiplies<uint32_t>>(registerRow(operation.first),
+                registerRow(operation.second), active, lanes);
+            break;
+        case Opcode::DIV: {
+            // There is no vector division, and the divisor may be zero in
+            // some of the lanes only
+            number_type *destination = registerRow(operation.first);
+            const number_type *source = registerRow(operation.second);
+            divides<long_number_type> division;
+            for(std::size_t i = 0; i < lanes; ++i) {
+                if(!active[i])
+                    continue;
+                try {
+                    destination[i] = static_cast<number_type>(
+                        division(destination[i], source[i]));
+                }
+                catch(...) {
+                    stop(i);
+                }
+            }
+            break;
+        }
+        default: { // PRINTLN
+            const number_type *source = registerRow(operation.first);
+            for(std::size_t i = 0; i < lanes; ++i) {
+                if(!active[i])
+                    continue;
+                try {
+                    output->println(i, source[i]);
+                }
+                catch(...) {
+                    stop(i);
+                }
+            }
+            break;
+        }
+    }
+
+    return faulted;
+}
+
+std::size_t ComputerBatch::taken(const Operation &operation, const Mask &mask,
+                                 Mask &result) {
+    const number_type *values = registerRow(operation.first);
+    switch(operation.opcode) {
+        case Opcode::JZ:
+            return compare<std::equal_to<number_type>>(values, mask.data(),
+                                                       result.data(), lanes);
+        case Opcode::JNZ:
+            return compare<std::not_equal_to<number_type>>(values, mask.data(),
+                                                           result.data(), lanes);
+        case Opcode::JGZ:
+            return compare<std::greater<number_type>>(values, mask.data(),
+                                                      result.data(), lanes);
+        default: // JLZ
+            return compare<std::less<number_type>>(values, mask.data(),
+                                                   result.data(), lanes);
+    }
+}
+
+std::vector<std::exception_ptr> ComputerBatch::execute(const std::string &code) {
+    MachineLimits machine{register_count, ram.size()};
+    ProgramPtr program = Assembler::compile(code, options, &machine);
+    std::fill(registers.begin(), registers.end(), 0);
+
+    // The operands are the same in all the lanes, so they are checked once
+    std::vector<std::exception_ptr> faults(program->size());
+    for(Program::size_type i = 0; i < program->size(); ++i)
+        faults[i] = fault((*program)[i], machine);
+
+    std::vector<std::exception_ptr> errors(lanes);
+    Mask running(lanes, ~0), group(lanes), branch(lanes);
+    // The position of each running lane, only kept while they diverge
+    std::vector<Program::size_type> position(lanes);
+    std::size_t remaining = lanes;
+
+    // While all the running lanes are at the same position, they form the
+    // group executed and the position is ip
+    Program::size_type ip = 0;
+    bool converged = true;
+
+    while(remaining > 0) {
+        std::size_t members = remaining;
+        if(!converged) {
+            ip = std::numeric_limits<Program::size_type>::max();
+            for(std::size_t i = 0; i < lanes; ++i)
+                if(running[i])
+                    ip = std::min(ip, position[i]);
+
+            members = 0;
+            for(std::size_t i = 0; i < lanes; ++i) {
+                group[i] = running[i] & -static_cast<number_type>(position[i] == ip);
+                members += group[i] & 1;
+            }
+            converged = members == remaining;
+        }
+        Mask &mask = converged ? running : group;
+
+        // The lowest position is past the end, hence all of them are
+        if(ip >= program->size())
+            break;
+
+        const Operation &operation = (*program)[ip];
+        Program::size_type next = ip + 1;
+
+        if(faults[ip]) {
+            for(std::size_t i = 0; i < lanes; ++i)
+                if(mask[i]) {
+                    errors[i] = faults[ip];
+                    group[i] = running[i] = 0;
+                }
+            remaining -= members;
+            continue;
+        }
+        else if(!isJump(operation.opcode)) {
+            std::size_t faulted = execute(operation, mask, running, errors);
+            remaining -= faulted;
+            members -= faulted;
+        }
+        else if(operation.opcode == Opcode::JMP)
+            next = jumpTarget(operation);
+        else {
+            std::size_t count = taken(operation, mask, branch);
+            if(count == members)
+                next = jumpTarget(operation);
+            else if(count > 0) {
+                // The group splits
+                Program::size_type target = jumpTarget(operation);
+                for(std::size_t i = 0; i < lanes; ++i)
+                    if(mask[i])
+                        position[i] = branch[i] ? target : next;
+                converged = false;
+                continue;
+            }
+        }
+
+        if(converged)
+            ip = next;
+        else
+            for(std::size_t i = 0; i < lanes; ++i)
+                if(group[i])
+                    position[i] = next;
+    }
+
+    for(std::size_t i = 0; i < lanes; ++i)
+        if(running[i])
+            output->processFinished(i);
+    output->flush();
+    return errors;
+}
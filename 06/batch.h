@@ -0,0 +1,101 @@
+#ifndef _BATCH_H
+#define _BATCH_H
+
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+#include "assembler.h"
+#include "common.h"
+#include "instruction.h"
+#include "output.h"
+#include "process.h"
+
+namespace computer_internal {
+// The same words of many machines (lanes), laid out as a structure of
+// arrays: the values of a word in all the lanes form a contiguous row, so
+// an instruction touches a single row per operand. The rows are allocated
+// (zero-filled) a page at a time on the first write.
+class LaneMemory {
+    private:
+    constexpr static const std::size_t PAGE_ROWS = 64;
+
+    number_type rows;
+    std::size_t width;
+    std::vector<std::unique_ptr<number_type[]>> pages;
+
+    public:
+    LaneMemory(number_type rows, std::size_t lanes);
+
+    // Null if the row has never been written, i.e. it is all zeros. The
+    // index has to be valid.
+    const number_type* row(number_type index) const;
+    number_type* writableRow(number_type index);
+
+    number_type size() const;
+    std::size_t lanes() const;
+};
+} // namespace computer_internal
+
+// Runs one program on many machines (lanes) which differ only in the initial
+// contents of their RAM. The lanes are executed in lockstep: every
+// instruction is executed for all the lanes at once, as a branch-free loop
+// over a row of their registers or memory cells, which the compiler
+// vectorizes. Lanes which take different branches are run a group at a time
+// (the group with the lowest position first) until they meet again.
+//
+// Each lane behaves like a single process run on its own computer. A fault
+// stops only the lanes which hit it, the other ones go on.
+class ComputerBatch {
+    private:
+    // ~0 for the lanes taking part in the instruction, 0 for the other ones
+    using Mask = std::vector<number_type>;
+
+    register_type register_count;
+    std::size_t lanes;
+    // The row of R1 first
+    std::vector<number_type> registers;
+    computer_internal::LaneMemory ram;
+    computer_internal::OutputPtr output;
+    CompilationOptions options;
+
+    number_type* registerRow(register_type reg);
+    void checkLane(std::size_t lane) const;
+
+    // The exception the instruction throws regardless of the values of the
+    // registers (null if its operands are valid)
+    static std::exception_ptr fault(const computer_internal::Operation &operation,
+                                    const computer_internal::MachineLimits &machine);
+    // Executes the instruction which is not a jump for the masked lanes.
+    // The lanes which fault are removed from the mask and from the running
+    // ones and their exceptions are stored. Returns the number of them.
+    std::size_t execute(const computer_internal::Operation &operation,
+                        Mask &mask, Mask &running,
+                        std::vector<std::exception_ptr> &errors);
+    // Whether the conditional jump is taken by each of the masked lanes,
+    // returns the number of them which take it
+    std::size_t taken(const computer_internal::Operation &operation,
+                      const Mask &mask, Mask &result);
+
+    public:
+    // Every lane has the given numbers of registers and memory cells
+    ComputerBatch(register_type registers, memory_type memory,
+                  std::size_t lanes);
+
+    std::size_t size() const;
+    void setCompilationOptions(const CompilationOptions &options);
+    // The lanes are the processes of the sink (by default the values are
+    // written to std::cout line by line)
+    void setOutput(std::shared_ptr<OutputSink> sink);
+
+    // The RAM of the lane, it is kept between the runs
+    void store(std::size_t lane, memory_type address, number_type value);
+    number_type load(std::size_t lane, memory_type address) const;
+
+    // Runs the program on every lane, starting with the registers cleared.
+    // Returns the exception which stopped each lane, null for the lanes
+    // which finished. The machine code is never used by the batch.
+    std::vector<std::exception_ptr> execute(const std::string &code);
+};
+
+#endif // _BATCH_H
@@ -0,0 +1,246 @@
+// Throughput benchmark of the emulator. Build it together with the sources
+// of the computer, e.g.
+//
+//     g++ -std=c++11 -O2 -pthread -I.. ../*.cc benchmark.cc -o benchmark
+//
+// and run as benchmark [workload] [scale] [cores]. Every workload is run
+// with each of the scheduling algorithms, one line of tab-separated results
+// per run, so that the output can be compared across versions. Each run is
+// made in a child process of its own, so its peak resident set size does
+// not include the memory of the other runs.
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <list>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include "computer.h"
+#include "program_cache.h"
+
+namespace {
+const register_type REGISTERS = 16;
+const memory_type MEMORY = 1 << 16;
+
+using Clock = std::chrono::steady_clock;
+
+struct Workload {
+    std::string name;
+    // Generates the programs for the scale
+    std::function<std::list<std::string>(unsigned, std::mt19937&)> generate;
+};
+
+struct Scheduling {
+    std::string name;
+    std::function<std::shared_ptr<SchedulingAlgorithm>()> create;
+};
+
+// Discards everything written to it
+class NullBuffer : public std::streambuf {
+    protected:
+    int overflow(int c) override {
+        return c;
+    }
+
+    std::streamsize xsputn(const char*, std::streamsize count) override {
+        return count;
+    }
+};
+
+std::string reg(std::mt19937 &random) {
+    return "R" + std::to_string(random() % REGISTERS + 1);
+}
+
+// Any register but R1, which is kept non-zero for the divisions
+std::string target(std::mt19937 &random) {
+    return "R" + std::to_string(random() % (REGISTERS - 1) + 2);
+}
+
+std::string cell(std::mt19937 &random) {
+    return "M" + std::to_string(random() % MEMORY);
+}
+
+std::string number(std::mt19937 &random) {
+    return std::to_string(static_cast<number_type>(random() % 2001) - 1000);
+}
+
+std::string arithmetic(std::mt19937 &random) {
+    static const char *mnemonics[] = {"ADD", "SUB", "MUL", "DIV"};
+    std::string mnemonic = mnemonics[random() % 4];
+    std::string rhs = mnemonic == "DIV" ? "R1" : reg(random);
+    return mnemonic + " " + target(random) + " " + rhs;
+}
+
+std::string program(std::mt19937 &random, unsigned length,
+                    std::function<std::string(std::mt19937&)> instruction) {
+    std::ostringstream code;
+    code << "SET R1 1\n";
+    for(unsigned i = 1; i < length; ++i)
+        code << instruction(random) << '\n';
+    return code.str();
+}
+
+std::list<std::string> programs(std::mt19937 &random, unsigned count,
+        unsigned length,
+        std::function<std::string(std::mt19937&)> instruction) {
+    std::list<std::string> result;
+    for(unsigned i = 0; i < count; ++i)
+        result.push_back(program(random, length, instruction));
+    return result;
+}
+
+std::string mixed(std::mt19937 &random) {
+    switch(random() % 6) {
+        case 0:
+            return "SET " + target(random) + " " + number(random);
+        case 1:
+            return "LOAD " + target(random) + " " + cell(random);
+        case 2:
+            return "STORE " + cell(random) + " " + reg(random);
+        case 3:
+            return "PRINTLN " + reg(random);
+        default:
+            return arithmetic(random);
+    }
+}
+
+std::string memory(std::mt19937 &random) {
+    switch(random() % 3) {
+        case 0:
+            return "LOAD " + target(random) + " " + cell(random);
+        case 1:
+            return "STORE " + cell(random) + " " + reg(random);
+        default:
+            return "ADD R2 R3";
+    }
+}
+
+std::string print(std::mt19937 &random) {
+    return random() % 4 ? "PRINTLN " + reg(random) : "SET R2 " + number(random);
+}
+
+const std::vector<Workload> WORKLOADS = {
+    {"many-short", [](unsigned scale, std::mt19937 &random) {
+        return programs(random, 20000 * scale, 20, mixed);
+    }},
+    {"few-huge", [](unsigned scale, std::mt19937 &random) {
+        return programs(random, 4, 500000 * scale, mixed);
+    }},
+    {"arithmetic", [](unsigned scale, std::mt19937 &random) {
+        return programs(random, 200 * scale, 5000, arithmetic);
+    }},
+    {"memory", [](unsigned scale, std::mt19937 &random) {
+        return programs(random, 200 * scale, 5000, memory);
+    }},
+    {"print", [](unsigned scale, std::mt19937 &random) {
+        return programs(random, 200 * scale, 5000, print);
+    }},
+};
+
+const std::vector<Scheduling> SCHEDULING = {
+    {"FCFS", []() { return createFCFSScheduling(); }},
+    {"RR", []() { return createRRScheduling(100); }},
+    {"SJF", []() { return createSJFScheduling(); }},
+};
+
+double seconds(Clock::duration duration) {
+    return std::chrono::duration<double>(duration).count();
+}
+
+void run(const Workload &workload, const Scheduling &scheduling,
+         const std::list<std::string> &sources, unsigned cores) {
+    Computer computer;
+    computer.setCPU(REGISTERS, cores);
+    computer.setRAM(MEMORY);
+
+    auto os = computer.installOS(scheduling.create());
+
+    NullBuffer discard;
+    std::ostream sink{&discard};
+    os->setOutput(std::make_shared<BufferedOutput>(sink));
+
+    // The first run compiles the programs (in parallel, as every run does)
+    // into the cache and the second one finds them there, so the difference
+    // between the two is the time the compilation takes
+    os->setProgramCache(std::make_shared<ProgramCache>(
+        std::numeric_limits<std::size_t>::max()));
+
+    auto start = Clock::now();
+    os->executePrograms(sources);
+    auto compiled = Clock::now();
+    os->executePrograms(sources);
+    auto finished = Clock::now();
+
+    // The programs are straight-line, one instruction per line, and never
+    // fault, so every instruction is executed exactly once
+    uint64_t instructions = 0;
+    for(const auto &code : sources)
+        instructions += std::count(code.begin(), code.end(), '\n');
+    double running = seconds(finished - compiled);
+    double compiling = seconds(compiled - start) - running;
+
+    std::cout << workload.name << '\t' << scheduling.name << '\t'
+              << sources.size() << '\t' << instructions << '\t'
+              << compiling << '\t' << running << '\t'
+              << static_cast<uint64_t>(instructions / running) << std::flush;
+}
+
+// Generates the programs of the workload and runs them in a child process,
+// then completes the line of the run with the peak resident set size of the
+// child in kilobytes. Returns false if the run failed.
+bool measure(const Workload &workload, const Scheduling &scheduling,
+             unsigned scale, unsigned cores) {
+    pid_t child = fork();
+    if(child < 0)
+        return false;
+    if(child == 0) {
+        // The same programs for every scheduling algorithm
+        std::mt19937 random{2017};
+        run(workload, scheduling, workload.generate(scale, random), cores);
+        std::_Exit(EXIT_SUCCESS);
+    }
+
+    int status;
+    rusage usage;
+    if(wait4(child, &status, 0, &usage) != child || !WIFEXITED(status)
+       || WEXITSTATUS(status) != EXIT_SUCCESS)
+        return false;
+    std::cout << '\t' << usage.ru_maxrss << std::endl;
+    return true;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    std::string only = argc > 1 ? argv[1] : "";
+    unsigned scale = argc > 2 ? std::atoi(argv[2]) : 1;
+    unsigned cores = argc > 3 ? std::atoi(argv[3]) : 1;
+
+    std::cout << "workload\tscheduling\tprograms\tinstructions\tcompile_s\t"
+              << "run_s\tinstructions_per_s\trun_peak_rss_kb" << std::endl;
+
+    for(const auto &workload : WORKLOADS) {
+        if(!only.empty() && only != "all" && only != workload.name)
+            continue;
+
+        for(const auto &scheduling : SCHEDULING) {
+            if(!measure(workload, scheduling, scale, cores)) {
+                std::cout << std::endl;
+                std::cerr << workload.name << " with " << scheduling.name
+                          << " failed" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+}
@@ -0,0 +1,163 @@
+#include "cache_model.h"
+
+#include <algorithm>
+
+using namespace computer_internal;
+
+CacheConfiguration::CacheConfiguration() : memory_latency{0} { }
+
+void CacheConfiguration::validate() const {
+    for(const auto &level : levels)
+        if(level.sets == 0 || level.ways == 0 || level.line_size == 0)
+            throw IllegalArgumentException("Empty cache level");
+    for(std::size_t i = 1; i < ranges.size(); ++i)
+        if(ranges[i] <= ranges[i - 1])
+            throw IllegalArgumentException("Ranges not in ascending order");
+}
+
+CacheCounters::CacheCounters(std::size_t levels)
+    : accesses{0}, hits(levels), cycles{0} { }
+
+uint64_t CacheCounters::reached(std::size_t level) const {
+    uint64_t result = accesses;
+    for(std::size_t i = 0; i < level && i < hits.size(); ++i)
+        result -= hits[i];
+    return result;
+}
+
+uint64_t CacheCounters::served(std::size_t level) const {
+    return level < hits.size() ? hits[level] : reached(level);
+}
+
+uint64_t CacheCounters::misses(std::size_t level) const {
+    return reached(level) - served(level);
+}
+
+double CacheCounters::hitRate(std::size_t level) const {
+    uint64_t total = reached(level);
+    return total ? static_cast<double>(served(level)) / total : 0;
+}
+
+double CacheCounters::missRate(std::size_t level) const {
+    uint64_t total = reached(level);
+    return total ? static_cast<double>(misses(level)) / total : 0;
+}
+
+CacheCounters& CacheCounters::operator+=(const CacheCounters &that) {
+    accesses += that.accesses;
+    if(hits.size() < that.hits.size())
+        hits.resize(that.hits.size());
+    for(std::size_t i = 0; i < that.hits.size(); ++i)
+        hits[i] += that.hits[i];
+    cycles += that.cycles;
+    return *this;
+}
+
+void CacheStatistics::clear(std::size_t levels, std::size_t processes,
+                            std::size_t ranges) {
+    total = CacheCounters{levels};
+    this->processes.assign(processes, CacheCounters{levels});
+    this->ranges.assign(ranges, CacheCounters{levels});
+}
+
+CacheStatistics& CacheStatistics::operator+=(const CacheStatistics &that) {
+    total += that.total;
+    if(processes.size() < that.processes.size())
+        processes.resize(that.processes.size());
+    for(std::size_t i = 0; i < that.processes.size(); ++i)
+        processes[i] += that.processes[i];
+    if(ranges.size() < that.ranges.size())
+        ranges.resize(that.ranges.size());
+    for(std::size_t i = 0; i < that.ranges.size(); ++i)
+        ranges[i] += that.ranges[i];
+    return *this;
+}
+
+namespace {
+void writeCounters(std::ostream &stream, const CacheCounters &counters) {
+    stream << "{\"accesses\":" << counters.accesses << ",\"hits\":[";
+    for(std::size_t i = 0; i < counters.hits.size(); ++i)
+        stream << (i ? "," : "") << counters.hits[i];
+    stream << "],\"cycles\":" << counters.cycles << '}';
+}
+} // namespace
+
+void CacheStatistics::writeJSON(std::ostream &stream) const {
+    stream << "{\"total\":";
+    writeCounters(stream, total);
+
+    stream << ",\"processes\":[";
+    for(std::size_t i = 0; i < processes.size(); ++i) {
+        stream << (i ? "," : "");
+        writeCounters(stream, processes[i]);
+    }
+
+    stream << "],\"ranges\":[";
+    for(std::size_t i = 0; i < ranges.size(); ++i) {
+        stream << (i ? "," : "");
+        writeCounters(stream, ranges[i]);
+    }
+    stream << "]}\n";
+}
+
+namespace computer_internal {
+bool CacheModel::Level::access(uint64_t line) {
+    std::size_t ways = configuration.ways;
+    auto set = lines.begin() + line % configuration.sets * ways;
+    auto found = std::find(set, set + ways, line + 1);
+
+    // Either the line found or the least recently used one is moved to the
+    // front, the latter being replaced
+    bool hit = found != set + ways;
+    auto used = hit ? found : set + ways - 1;
+    std::rotate(set, used, used + 1);
+    *set = line + 1;
+    return hit;
+}
+
+CacheModel::CacheModel(const CacheConfiguration &configuration,
+                       std::size_t processes)
+    : memory_latency{configuration.memory_latency}
+    , ranges(configuration.ranges) {
+    configuration.validate();
+    for(const auto &level : configuration.levels)
+        levels.push_back(Level{level, std::vector<uint64_t>(
+            level.sets * level.ways)});
+    counters.clear(levels.size(), processes, ranges.size() + 1);
+}
+
+std::size_t CacheModel::range(memory_type address) const {
+    return std::upper_bound(ranges.begin(), ranges.end(), address)
+        - ranges.begin();
+}
+
+void CacheModel::access(pid_type process, memory_type address) {
+    uint64_t cycles = 0;
+    std::size_t level = 0;
+    for(; level < levels.size(); ++level) {
+        Level &current = levels[level];
+        cycles += current.configuration.latency;
+        if(current.access(static_cast<uint64_t>(address)
+                          / current.configuration.line_size))
+            break;
+    }
+    // The levels missed have got the line on the way
+    if(level == levels.size())
+        cycles += memory_latency;
+
+    CacheCounters *updated[] = {
+        &counters.total, &counters.processes[process],
+        &counters.ranges[range(address)]
+    };
+    for(CacheCounters *counter : updated) {
+        ++counter->accesses;
+        if(level < levels.size())
+            ++counter->hits[level];
+        counter->cycles += cycles;
+    }
+}
+
+const CacheStatistics& CacheModel::statistics() const {
+    return counters;
+}
+} // namespace computer_internal
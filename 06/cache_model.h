@@ -0,0 +1,109 @@
+#ifndef _CACHE_MODEL_H
+#define _CACHE_MODEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "common.h"
+
+// A single level of the modeled cache hierarchy. Lines are replaced in the
+// least recently used order within their set.
+struct CacheLevel {
+    std::size_t sets;
+    std::size_t ways;
+    // In memory cells
+    std::size_t line_size;
+    // The cycles added by every access which reaches this level, so a hit
+    // takes the latencies of all the levels up to this one
+    uint64_t latency;
+};
+
+// The cache hierarchy modeled for the accesses of the LOAD and STORE
+// instructions. Every core has a hierarchy of its own, the caches start
+// empty in every run. Stores allocate the line just like loads do.
+struct CacheConfiguration {
+    // The closest level first. The levels missed by an access are probed in
+    // order and all of them get the line.
+    std::vector<CacheLevel> levels;
+    // The cycles added by an access which misses all the levels
+    uint64_t memory_latency;
+    // The boundaries between the address ranges counted separately, in
+    // ascending order. There is one range more than the boundaries, the
+    // first one starts at zero.
+    std::vector<memory_type> ranges;
+
+    CacheConfiguration();
+    // Throws IllegalArgumentException if some level is empty or the
+    // boundaries are not ascending
+    void validate() const;
+};
+
+// The accesses made by a process or to an address range
+struct CacheCounters {
+    uint64_t accesses;
+    // Indexed by the level. The accesses which missed all the levels went
+    // to the memory.
+    std::vector<uint64_t> hits;
+    uint64_t cycles;
+
+    CacheCounters(std::size_t levels = 0);
+    // The accesses which reached the level (the memory is the level past
+    // the last one)
+    uint64_t reached(std::size_t level) const;
+    // The memory serves every access which reaches it, so it has no misses
+    uint64_t served(std::size_t level) const;
+    uint64_t misses(std::size_t level) const;
+    // Of the accesses which reached the level, zero if there were none
+    double hitRate(std::size_t level) const;
+    double missRate(std::size_t level) const;
+
+    CacheCounters& operator+=(const CacheCounters &that);
+};
+
+// The accesses of the last run. Empty unless the cache model is enabled.
+struct CacheStatistics {
+    CacheCounters total;
+    // Indexed by the process
+    std::vector<CacheCounters> processes;
+    // In the order of the addresses
+    std::vector<CacheCounters> ranges;
+
+    void clear(std::size_t levels = 0, std::size_t processes = 0,
+               std::size_t ranges = 0);
+    CacheStatistics& operator+=(const CacheStatistics &that);
+    void writeJSON(std::ostream &stream) const;
+};
+
+namespace computer_internal {
+// The cache hierarchy of a single core, it is only used by that core
+class CacheModel {
+    private:
+    struct Level {
+        CacheLevel configuration;
+        // The ways of every set, the most recently used first. Zero is an
+        // empty way, the other ones hold the line number plus one.
+        std::vector<uint64_t> lines;
+
+        // Whether the line was present. It is the most recently used one
+        // of its set afterwards.
+        bool access(uint64_t line);
+    };
+
+    std::vector<Level> levels;
+    uint64_t memory_latency;
+    std::vector<memory_type> ranges;
+    CacheStatistics counters;
+
+    std::size_t range(memory_type address) const;
+
+    public:
+    CacheModel(const CacheConfiguration &configuration, std::size_t processes);
+
+    // Models an access made by the process to a valid address
+    void access(pid_type process, memory_type address);
+    const CacheStatistics& statistics() const;
+};
+} // namespace computer_internal
+
+#endif // _CACHE_MODEL_H
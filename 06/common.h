@@ -1,6 +1,7 @@
 #ifndef _COMMON_H
 #define _COMMON_H
 
+#include <cstddef>
 #include <cstdint>
 #include <cinttypes>
 #include <string>
@@ -10,9 +11,32 @@ using number_type = int32_t;
 using register_type = number_type;
 using memory_type = number_type;
 using time_type = number_type;
+using pid_type = std::size_t;
 
 namespace computer_internal {
 using long_number_type = int64_t;
+
+// Whether the CPUs and the OS collect the execution statistics. Otherwise
+// the code collecting them is compiled away.
+#ifdef COMPUTER_STATISTICS
+constexpr bool COLLECT_STATISTICS = true;
+#else
+constexpr bool COLLECT_STATISTICS = false;
+#endif
+
+// The numbers of registers and memory cells of a machine
+struct MachineLimits {
+    register_type registers;
+    memory_type memory;
+
+    bool validRegister(register_type reg) const {
+        return reg >= 1 && reg <= registers;
+    }
+
+    bool validAddress(memory_type address) const {
+        return address >= 0 && address < memory;
+    }
+};
 }
 
 class IllegalArgumentException : public std::invalid_argument {
@@ -28,6 +52,12 @@ class UnknownInstructionException : public std::invalid_argument {
         : std::invalid_argument("Unknown instruction: " + instruction) { }
 };
 
+class UndefinedLabelException : public std::invalid_argument {
+    public:
+    UndefinedLabelException(const std::string &label)
+        : std::invalid_argument("Undefined label: " + label) { }
+};
+
 class InvalidRegisterException : public std::out_of_range {
     public:
     InvalidRegisterException(register_type reg)
@@ -68,6 +98,20 @@ class ParserException : public std::invalid_argument {
                                 "\":" + std::to_string(position)) { }
 };
 
+class FileException : public std::runtime_error {
+    public:
+    FileException(const std::string &path, const std::string &cause,
+                  const std::string &operation = "read")
+        : std::runtime_error("Unable to " + operation + " " + path +
+                             ": " + cause) { }
+};
+
+class InvalidObjectException : public std::invalid_argument {
+    public:
+    InvalidObjectException(const std::string &cause)
+        : std::invalid_argument("Invalid object file: " + cause) { }
+};
+
 class IllegalChangeException : public std::logic_error {
     public:
     IllegalChangeException()
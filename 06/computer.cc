@@ -11,29 +11,38 @@ Computer& Computer::operator=(const Computer &that) {
     if(changes_disabled)
         throw IllegalChangeException();
 
-    decltype(cpu) newcpu = nullptr;
+    decltype(cpus) newcpus;
     decltype(ram) newram = nullptr;
 
-    if(that.cpu)
-        newcpu = std::make_shared<CPU>(*that.cpu);
+    for(const auto &cpu : that.cpus)
+        newcpus.push_back(std::make_shared<CPU>(*cpu));
 
     if(that.ram) {
         newram = std::make_shared<RAM>(*that.ram);
-        if(newcpu)
-            newcpu->setRAM(newram);
+        for(const auto &cpu : newcpus)
+            cpu->setRAM(newram);
     }
 
     // Now entering the non-throwing part
-    cpu = newcpu;
+    cpus.swap(newcpus);
     ram = newram;
+    costs = that.costs;
     return *this;
 }
 
-void Computer::setCPU(register_type numOfRegisters) {
+void Computer::setCPU(register_type numOfRegisters, unsigned cores) {
     if(changes_disabled)
         throw IllegalChangeException();
+    if(cores == 0)
+        throw IllegalArgumentException("No cores requested");
 
-    cpu = std::make_shared<CPU>(numOfRegisters, ram);
+    decltype(cpus) newcpus;
+    for(unsigned i = 0; i < cores; ++i) {
+        newcpus.push_back(std::make_shared<CPU>(numOfRegisters, ram));
+        newcpus.back()->setCycleCosts(costs);
+    }
+
+    cpus.swap(newcpus);
 }
 
 void Computer::setRAM(memory_type size) {
@@ -41,19 +50,29 @@ void Computer::setRAM(memory_type size) {
         throw IllegalChangeException();
 
     ram = std::make_shared<RAM>(size);
-    if(cpu)
+    for(const auto &cpu : cpus)
         cpu->setRAM(ram);
 }
 
+void Computer::setCycleCosts(const CycleCosts &costs) {
+    if(changes_disabled)
+        throw IllegalChangeException();
+
+    this->costs = costs;
+    for(const auto &cpu : cpus)
+        cpu->setCycleCosts(costs);
+}
+
 std::shared_ptr<OS> Computer::installOS(std::shared_ptr<SchedulingAlgorithm> alg) {
     if(!ram)
         throw NoRAMException();
-    if(!cpu)
+    if(cpus.empty())
         throw NoCPUException();
 
-    cpu->clearRegisters();
+    for(const auto &cpu : cpus)
+        cpu->clearRegisters();
     ram->clear();
     changes_disabled = true;
 
-    return std::shared_ptr<OS>{new OS{cpu, alg}};
+    return std::shared_ptr<OS>{new OS{cpus, ram, alg}};
 }
@@ -2,8 +2,10 @@
 #define _COMPUTER_H
 
 #include <memory>
+#include <vector>
 #include "common.h"
 #include "cpu.h"
+#include "cycle_costs.h"
 #include "memory.h"
 #include "scheduler.h"
 #include "os.h"
@@ -14,19 +16,26 @@ class Computer {
     // If true, every change (such as setting CPU or RAM) will result in an
     // exception
     bool changes_disabled;
-    std::shared_ptr<computer_internal::CPU> cpu;
+    // Every core has its own registers, the RAM is shared
+    std::vector<std::shared_ptr<computer_internal::CPU>> cpus;
     std::shared_ptr<computer_internal::RAM> ram;
+    CycleCosts costs;
 
     public:
     Computer();
 
     // Copy {constructor,assignment operator} perform a deep copy, i.e. the
-    // RAM and CPU are copied themselves, not merely the pointers to them
+    // RAM and CPU are copied themselves, not merely the pointers to them.
+    // The RAM is copied on write, so copying takes constant time and the
+    // pages are duplicated only when either of the copies writes to them.
     Computer(const Computer&);
     Computer& operator=(const Computer&);
 
-    void setCPU(register_type numOfRegisters);
+    // Each of the cores is run by a separate host thread
+    void setCPU(register_type numOfRegisters, unsigned cores = 1);
     void setRAM(memory_type size);
+    // The cycles taken by the instructions on every core
+    void setCycleCosts(const CycleCosts &costs);
     std::shared_ptr<OS> installOS(std::shared_ptr<SchedulingAlgorithm> alg);
 };
 
@@ -1,4 +1,6 @@
 #include "cpu.h"
+#include <algorithm>
+#include <limits>
 
 namespace computer_internal {
 void CPU::requireLevel(ProtectionLevel level) {
@@ -12,13 +14,254 @@ void CPU::interrupt() {
     current_level = ProtectionLevel::RING3;
 }
 
-void CPU::timerTick() {
-    if(timer_active && --timer == 0) {
+void CPU::timerTick(uint64_t elapsed) {
+    // A negative timer never fires, a positive one stops at zero even if the
+    // last instruction took longer
+    if(timer_active && timer > 0
+            && (timer -= static_cast<time_type>(std::min<uint64_t>(
+                    elapsed, static_cast<uint64_t>(timer)))) == 0) {
         timer_active = false;
+#ifdef COMPUTER_STATISTICS
+        ++counters.timer_interrupts;
+#endif
         interrupt();
     }
 }
 
+template<bool Checked, class Concrete>
+void CPU::dispatch(const Concrete &instruction, ExecutionContext &context) {
+    if(Checked)
+        instruction.execute(context);
+    else
+        instruction.executeUnchecked(context);
+}
+
+template<bool Checked, class Branch>
+Program::size_type CPU::branch(const Branch &instruction,
+                               const Operation &operation,
+                               Program::size_type ip,
+                               ExecutionContext &context) {
+    bool taken = Checked ? instruction.taken(context)
+                         : instruction.takenUnchecked(context);
+    return taken ? jumpTarget(operation) : ip + 1;
+}
+
+template<bool Checked>
+Program::size_type CPU::execute(const Operation &operation,
+                                Program::size_type ip,
+                                ExecutionContext &context) {
+    code_type first = operation.first;
+    code_type second = operation.second;
+
+    switch(operation.opcode) {
+        case Opcode::SET:
+        case Opcode::SET_ADD:
+        case Opcode::SET_SUB:
+        case Opcode::SET_MUL:
+        case Opcode::SET_DIV:
+            dispatch<Checked>(SetInstruction{first, second}, context);
+            break;
+        case Opcode::LOAD:
+        case Opcode::LOAD_ADD_STORE:
+        case Opcode::LOAD_SUB_STORE:
+        case Opcode::LOAD_MUL_STORE:
+        case Opcode::LOAD_DIV_STORE:
+            dispatch<Checked>(LoadInstruction{first, second}, context);
+            break;
+        case Opcode::STORE:
+            dispatch<Checked>(StoreInstruction{first, second}, context);
+            break;
+        case Opcode::ADD:
+            dispatch<Checked>(AddInstruction{first, second}, context);
+            break;
+        case Opcode::SUB:
+            dispatch<Checked>(SubInstruction{first, second}, context);
+            break;
+        case Opcode::MUL:
+            dispatch<Checked>(MulInstruction{first, second}, context);
+            break;
+        case Opcode::DIV:
+            dispatch<Checked>(DivInstruction{first, second}, context);
+            break;
+        case Opcode::PRINTLN:
+            dispatch<Checked>(PrintlnInstruction{first}, context);
+            break;
+        case Opcode::JMP:
+            return first;
+        case Opcode::JZ:
+            return branch<Checked>(JzInstruction{first}, operation, ip, context);
+        case Opcode::JNZ:
+            return branch<Checked>(JnzInstruction{first}, operation, ip,
+                                   context);
+        case Opcode::JGZ:
+            return branch<Checked>(JgzInstruction{first}, operation, ip,
+                                   context);
+        case Opcode::JLZ:
+            return branch<Checked>(JlzInstruction{first}, operation, ip,
+                                   context);
+    }
+
+    return ip + 1;
+}
+
+template<bool Checked, class Arithmetic>
+void CPU::executeSetArithmetic(const Operation *operations,
+                               ExecutionContext &context) {
+    dispatch<Checked>(SetInstruction{operations[0].first,
+                                     operations[0].second}, context);
+    dispatch<Checked>(Arithmetic{operations[1].first,
+                                 operations[1].second}, context);
+}
+
+template<bool Checked, class Arithmetic>
+void CPU::executeLoadArithmeticStore(const Operation *operations,
+                                     ExecutionContext &context) {
+    dispatch<Checked>(LoadInstruction{operations[0].first,
+                                      operations[0].second}, context);
+    dispatch<Checked>(Arithmetic{operations[1].first,
+                                 operations[1].second}, context);
+    dispatch<Checked>(StoreInstruction{operations[2].first,
+                                       operations[2].second}, context);
+}
+
+template<bool Checked>
+void CPU::executeFused(const Operation *operations, ExecutionContext &context) {
+    switch(operations->opcode) {
+        case Opcode::SET_ADD:
+            executeSetArithmetic<Checked, AddInstruction>(operations, context);
+            break;
+        case Opcode::SET_SUB:
+            executeSetArithmetic<Checked, SubInstruction>(operations, context);
+            break;
+        case Opcode::SET_MUL:
+            executeSetArithmetic<Checked, MulInstruction>(operations, context);
+            break;
+        case Opcode::SET_DIV:
+            executeSetArithmetic<Checked, DivInstruction>(operations, context);
+            break;
+        case Opcode::LOAD_ADD_STORE:
+            executeLoadArithmeticStore<Checked, AddInstruction>(operations,
+                                                                context);
+            break;
+        case Opcode::LOAD_SUB_STORE:
+            executeLoadArithmeticStore<Checked, SubInstruction>(operations,
+                                                                context);
+            break;
+        case Opcode::LOAD_MUL_STORE:
+            executeLoadArithmeticStore<Checked, MulInstruction>(operations,
+                                                                context);
+            break;
+        case Opcode::LOAD_DIV_STORE:
+            executeLoadArithmeticStore<Checked, DivInstruction>(operations,
+                                                                context);
+            break;
+        default:
+            execute<Checked>(*operations, 0, context);
+            break;
+    }
+}
+
+template<bool Checked>
+Program::size_type CPU::runRange(const Program &program,
+                                 Program::size_type ip,
+                                 Program::size_type validated,
+                                 int64_t &left,
+                                 ExecutionContext &context) {
+    // The checked instructions are only executed until a jump leads back
+    // into the validated prefix
+    while(left > 0 && (Checked ? ip >= validated && ip < program.size()
+                               : ip < validated)) {
+        const Operation &operation = program[ip];
+        Program::size_type length = fusedLength(operation.opcode);
+
+        // A superinstruction may only be executed as a whole if the timer
+        // would not fire in the middle of the fused sequence, i.e. if some
+        // cycles are left for its last instruction (and if the whole
+        // sequence is validated)
+        if(length > 1 && (Checked || ip + length <= validated)) {
+            int64_t leading = cycles[static_cast<std::size_t>(
+                operation.opcode)];
+            for(Program::size_type i = 1; i + 1 < length; ++i)
+                leading += cycles[static_cast<std::size_t>(
+                    program[ip + i].opcode)];
+
+            if(leading < left) {
+                executeFused<Checked>(&operation, context);
+#ifdef COMPUTER_STATISTICS
+                ++counters.opcodes[static_cast<std::size_t>(
+                    baseOpcode(operation.opcode))];
+                for(Program::size_type i = 1; i < length; ++i)
+                    ++counters.opcodes[static_cast<std::size_t>(
+                        program[ip + i].opcode)];
+                counters.slice += length;
+#endif
+                left -= leading + cycles[static_cast<std::size_t>(
+                    program[ip + length - 1].opcode)];
+                ip += length;
+                continue;
+            }
+        }
+
+        ip = execute<Checked>(operation, ip, context);
+#ifdef COMPUTER_STATISTICS
+        ++counters.opcodes[static_cast<std::size_t>(
+            baseOpcode(operation.opcode))];
+        ++counters.slice;
+#endif
+        left -= cycles[static_cast<std::size_t>(operation.opcode)];
+    }
+
+    return ip;
+}
+
+Program::size_type CPU::runNative(const NativeCode &native,
+                                  const Program &program,
+                                  Program::size_type ip,
+                                  int64_t &left,
+                                  ExecutionContext &context) {
+    Program::size_type next = native.run(ip, left, context);
+#ifdef COMPUTER_STATISTICS
+    for(Program::size_type i = ip; i < next; ++i)
+        ++counters.opcodes[static_cast<std::size_t>(
+            baseOpcode(program[i].opcode))];
+    counters.slice += next - ip;
+#else
+    static_cast<void>(program);
+#endif
+    return next;
+}
+
+void CPU::runJob(ExecutionContext &context) {
+    const Program &program = job->program();
+    Program::size_type ip = job->position();
+    Program::size_type validated = job->validated();
+    const NativeCode *native = job->native();
+    context.process = job->id();
+
+    // The loops of the program make its running time unknown, so the
+    // cycles are counted until the timer fires. A negative timer never
+    // fires.
+    int64_t budget = std::numeric_limits<int64_t>::max();
+    if(timer_active && timer > 0)
+        budget = timer;
+
+    int64_t left = budget;
+    while(left > 0 && ip < program.size()) {
+        if(native && native->runnable(ip, left))
+            ip = runNative(*native, program, ip, left, context);
+        else if(ip < validated)
+            ip = runRange<false>(program, ip, validated, left, context);
+        else
+            ip = runRange<true>(program, ip, validated, left, context);
+    }
+
+    // Including the cycles the last instruction took past the budget
+    auto executed = static_cast<uint64_t>(budget - left);
+    job->seek(ip);
+    job->account(executed);
+    timerTick(executed);
+}
+
 CPU::restorer::restorer(CPU *cpu) : cpu{cpu} { }
 
 CPU::restorer::~restorer() {
@@ -30,17 +273,25 @@ CPU::restorer::~restorer() {
 CPU::CPU(register_type register_count, RAMPtr ram)
     : registers{std::make_shared<RegisterSet>(register_count)}
     , ram{ram}
+    , output{StreamOutput::standard()}
     , timer{0}
     , timer_active{false}
+    , job{nullptr}
     , awake{false}
-    , current_level{ProtectionLevel::RING0}
-    { }
+    , current_level{ProtectionLevel::RING0} {
+    setCycleCosts(CycleCosts{});
+}
 
 CPU::CPU(const CPU &that)
     : registers{std::make_shared<RegisterSet>(*that.registers)}
     , ram{}
+    , output{that.output}
+    , cache{}
     , timer{0}
     , timer_active{false}
+    , costs{that.costs}
+    , cycles(that.cycles)
+    , job{nullptr}
     , awake{false}
     , current_level{ProtectionLevel::RING0}
     { }
@@ -48,9 +299,17 @@ CPU::CPU(const CPU &that)
 CPU& CPU::operator=(const CPU &that) {
     registers = std::make_shared<RegisterSet>(*that.registers);
     ram = nullptr;
+    output = that.output;
+    cache = nullptr;
     timer = 0;
     timer_active = false;
+    costs = that.costs;
+    cycles = that.cycles;
+    job = nullptr;
     awake = false;
+#ifdef COMPUTER_STATISTICS
+    counters.clear();
+#endif
     current_level = ProtectionLevel::RING0;
 
     return *this;
@@ -60,6 +319,32 @@ void CPU::setRAM(RAMPtr ram) {
     this->ram = ram;
 }
 
+void CPU::setOutput(OutputPtr output) {
+    this->output = output;
+}
+
+void CPU::setCycleCosts(const CycleCosts &costs) {
+    this->costs = costs;
+    for(std::size_t i = 0; i < OPCODES; ++i)
+        cycles[i] = costs.get(static_cast<Opcode>(i));
+}
+
+const CycleCosts& CPU::cycleCosts() const {
+    return costs;
+}
+
+void CPU::setCacheModel(std::shared_ptr<CacheModel> model) {
+    cache = model;
+}
+
+const CacheModel* CPU::cacheModel() const {
+    return cache.get();
+}
+
+MachineLimits CPU::limits() const {
+    return {registers->size(), ram ? ram->size() : 0};
+}
+
 void CPU::clearRegisters() {
     registers->clear();
 }
@@ -74,16 +359,39 @@ void CPU::sleep() {
     awake = false;
 }
 
-void CPU::setJob(ProcessPtr process) {
+void CPU::setJob(Process *process) {
     requireLevel(ProtectionLevel::RING0);
     job = process;
+#ifdef COMPUTER_STATISTICS
+    counters.slice = 0;
+#endif
+}
+
+const CoreCounters& CPU::statistics() const {
+#ifdef COMPUTER_STATISTICS
+    return counters;
+#else
+    static const CoreCounters none;
+    return none;
+#endif
+}
+
+void CPU::clearStatistics() {
+#ifdef COMPUTER_STATISTICS
+    counters.clear();
+#endif
 }
 
 void CPU::awaken() {
     requireLevel(ProtectionLevel::RING0);
 
+    if(!ram)
+        throw NoRAMException();
+
     awake = true;
     restorer graceful_exit{this};
+    ExecutionContext context{*registers, *ram, *output};
+    context.cache = cache.get();
 
     while(awake) {
         if(!job || !job->hasNext()) {
@@ -91,8 +399,7 @@ void CPU::awaken() {
             continue;
         }
 
-        job->next()->execute(registers, ram);
-        timerTick();
+        runJob(context);
     }
 }
 
@@ -1,10 +1,16 @@
 #ifndef _CPU_H
 #define _CPU_H
 
+#include <array>
 #include <memory>
+#include "cache_model.h"
 #include "common.h"
+#include "cycle_costs.h"
 #include "memory.h"
+#include "native_code.h"
+#include "output.h"
 #include "process.h"
+#include "statistics.h"
 
 namespace computer_internal {
 class CPU {
@@ -14,19 +20,76 @@ class CPU {
     private:
     RegisterSetPtr registers;
     RAMPtr ram;
+    OutputPtr output;
+    // Null if the memory accesses are not modeled
+    std::shared_ptr<CacheModel> cache;
 
     time_type timer;
     bool timer_active;
+    CycleCosts costs;
+    // The cycles of every opcode executed alone
+    std::array<int64_t, OPCODES> cycles;
 
     interrupt_handler_type interrupt_handler;
-    ProcessPtr job;
+    // Null if there is none
+    Process *job;
     bool awake;
+#ifdef COMPUTER_STATISTICS
+    CoreCounters counters;
+#endif
 
     enum class ProtectionLevel { RING0, RING3 } current_level;
 
     void requireLevel(ProtectionLevel level);
     void interrupt();
-    void timerTick();
+    void timerTick(uint64_t elapsed);
+    // Executes the instructions of the job until the timer fires or the
+    // job finishes, and only then updates the timer. An instruction is
+    // executed as long as some of the cycles are left, so the last one may
+    // take more than that. The validated prefix of the program is executed
+    // without the bounds checks, its translated part as the machine code.
+    void runJob(ExecutionContext &context);
+    // Executes the instructions starting at ip as the machine code, and
+    // counts them if COLLECT_STATISTICS
+    Program::size_type runNative(const NativeCode &native,
+                                 const Program &program,
+                                 Program::size_type ip,
+                                 int64_t &left,
+                                 ExecutionContext &context);
+    // Executes the instructions starting at ip while they stay inside (or,
+    // if checked, outside) the validated prefix and there are some cycles
+    // left. Returns the position of the next one.
+    template<bool Checked>
+    Program::size_type runRange(const Program &program,
+                                Program::size_type ip,
+                                Program::size_type validated,
+                                int64_t &left,
+                                ExecutionContext &context);
+    // Decodes a single instruction of the program image, executes it and
+    // returns the position of the next one. Superinstructions are executed
+    // as their first instruction only.
+    template<bool Checked>
+    static Program::size_type execute(const Operation &operation,
+                                      Program::size_type ip,
+                                      ExecutionContext &context);
+    // Executes the whole sequence fused into a superinstruction
+    template<bool Checked>
+    static void executeFused(const Operation *operations,
+                             ExecutionContext &context);
+
+    template<bool Checked, class Arithmetic>
+    static void executeSetArithmetic(const Operation *operations,
+                                     ExecutionContext &context);
+    template<bool Checked, class Arithmetic>
+    static void executeLoadArithmeticStore(const Operation *operations,
+                                           ExecutionContext &context);
+    template<bool Checked, class Branch>
+    static Program::size_type branch(const Branch &instruction,
+                                     const Operation &operation,
+                                     Program::size_type ip,
+                                     ExecutionContext &context);
+    template<bool Checked, class Concrete>
+    static void dispatch(const Concrete &instruction, ExecutionContext &context);
 
     class restorer {
         private:
@@ -41,10 +104,21 @@ class CPU {
     CPU(const CPU&);
     CPU& operator=(const CPU&);
     void setRAM(RAMPtr ram);
+    void setOutput(OutputPtr output);
+    void setCycleCosts(const CycleCosts &costs);
+    const CycleCosts& cycleCosts() const;
+    void setCacheModel(std::shared_ptr<CacheModel> model);
+    // Null if there is none
+    const CacheModel* cacheModel() const;
+    MachineLimits limits() const;
     void clearRegisters();
     void setInterruptHandler(interrupt_handler_type handler);
     void sleep();
-    void setJob(ProcessPtr process);
+    // Also starts a new slice of the counters
+    void setJob(Process *process);
+    // Always zero unless COLLECT_STATISTICS
+    const CoreCounters& statistics() const;
+    void clearStatistics();
     void awaken();
     void setTimer(time_type left);
     void disableTimer();
@@ -0,0 +1,31 @@
+#include "cycle_costs.h"
+
+using namespace computer_internal;
+
+CycleCosts::CycleCosts() {
+    cycles.fill(1);
+}
+
+void CycleCosts::set(const std::string &name, uint32_t cost) {
+    if(cost == 0)
+        throw IllegalArgumentException("An instruction has to take a cycle");
+
+    for(std::size_t i = 0; i < BASE_OPCODES; ++i)
+        if(name == mnemonic(static_cast<Opcode>(i))) {
+            cycles[i] = cost;
+            return;
+        }
+    throw UnknownInstructionException(name);
+}
+
+uint32_t CycleCosts::get(Opcode opcode) const {
+    return cycles[static_cast<std::size_t>(baseOpcode(opcode))];
+}
+
+bool CycleCosts::operator==(const CycleCosts &that) const {
+    return cycles == that.cycles;
+}
+
+bool CycleCosts::operator!=(const CycleCosts &that) const {
+    return !(*this == that);
+}
@@ -0,0 +1,31 @@
+#ifndef _CYCLE_COSTS_H
+#define _CYCLE_COSTS_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include "common.h"
+#include "instruction.h"
+
+// The cycles taken by each of the instructions, one by default. The timer
+// and the emulated time of the processes count the cycles, so the quanta of
+// the scheduling algorithms are given in cycles. A superinstruction takes
+// the cycles of the instructions it fuses.
+class CycleCosts {
+    private:
+    std::array<uint32_t, computer_internal::BASE_OPCODES> cycles;
+
+    public:
+    CycleCosts();
+
+    // Throws UnknownInstructionException if there is no such instruction
+    // and IllegalArgumentException if the instruction would take no time
+    void set(const std::string &mnemonic, uint32_t cycles);
+    // Superinstructions take the cycles of their first instruction
+    uint32_t get(computer_internal::Opcode opcode) const;
+
+    bool operator==(const CycleCosts &that) const;
+    bool operator!=(const CycleCosts &that) const;
+};
+
+#endif // _CYCLE_COSTS_H
@@ -0,0 +1,41 @@
+#include "farm.h"
+
+#include <sstream>
+
+using namespace computer_internal;
+
+ComputerFarm::ComputerFarm(unsigned threads) : pool{threads} { }
+
+ComputerFarm::Result ComputerFarm::runJob(const Job &job) {
+    Result result;
+    std::ostringstream output;
+
+    try {
+        Computer computer{job.machine};
+        auto os = computer.installOS(job.scheduling());
+        os->setCompilationOptions(job.options);
+        os->setProgramCache(job.cache);
+        os->setOutput(std::make_shared<BufferedOutput>(output));
+        os->executePrograms(job.programs);
+    }
+    catch(...) {
+        result.error = std::current_exception();
+    }
+
+    result.output = output.str();
+    return result;
+}
+
+std::vector<ComputerFarm::Result> ComputerFarm::run(const std::vector<Job> &jobs) {
+    std::vector<Result> results(jobs.size());
+    std::vector<ThreadPool::task_type> tasks;
+    tasks.reserve(jobs.size());
+
+    for(std::size_t i = 0; i < jobs.size(); ++i)
+        tasks.push_back([&results, &jobs, i]() {
+            results[i] = runJob(jobs[i]);
+        });
+
+    pool.run(std::move(tasks));
+    return results;
+}
@@ -0,0 +1,54 @@
+#ifndef _FARM_H
+#define _FARM_H
+
+#include <exception>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "assembler.h"
+#include "computer.h"
+#include "program_cache.h"
+#include "scheduler.h"
+#include "thread_pool.h"
+
+// Runs many independent computers in parallel on a work-stealing thread pool
+class ComputerFarm {
+    public:
+    // Scheduling algorithms keep the state of the processes, so every job
+    // needs a fresh one
+    using scheduling_factory = std::function<std::shared_ptr<SchedulingAlgorithm>()>;
+
+    struct Job {
+        // A configured computer (without an OS), copied before the run
+        Computer machine;
+        scheduling_factory scheduling;
+        std::list<std::string> programs;
+        CompilationOptions options;
+        // Shared by the jobs, may be null
+        std::shared_ptr<ProgramCache> cache;
+    };
+
+    struct Result {
+        // Everything printed by the processes of the job
+        std::string output;
+        // The exception thrown by the job (null if none was thrown)
+        std::exception_ptr error;
+    };
+
+    private:
+    computer_internal::ThreadPool pool;
+
+    static Result runJob(const Job &job);
+
+    public:
+    // Sized to the host by default
+    explicit ComputerFarm(unsigned threads = std::thread::hardware_concurrency());
+
+    // The results are in the order of the jobs
+    std::vector<Result> run(const std::vector<Job> &jobs);
+};
+
+#endif // _FARM_H
@@ -1,37 +1,157 @@
 #include "instruction.h"
-
-#include <iostream>
+#include "cache_model.h"
 
 namespace computer_internal {
+time_type fusedLength(Opcode opcode) {
+    switch(opcode) {
+        case Opcode::SET_ADD:
+        case Opcode::SET_SUB:
+        case Opcode::SET_MUL:
+        case Opcode::SET_DIV:
+            return 2;
+        case Opcode::LOAD_ADD_STORE:
+        case Opcode::LOAD_SUB_STORE:
+        case Opcode::LOAD_MUL_STORE:
+        case Opcode::LOAD_DIV_STORE:
+            return 3;
+        default:
+            return 1;
+    }
+}
+
+Opcode baseOpcode(Opcode opcode) {
+    switch(opcode) {
+        case Opcode::SET_ADD:
+        case Opcode::SET_SUB:
+        case Opcode::SET_MUL:
+        case Opcode::SET_DIV:
+            return Opcode::SET;
+        case Opcode::LOAD_ADD_STORE:
+        case Opcode::LOAD_SUB_STORE:
+        case Opcode::LOAD_MUL_STORE:
+        case Opcode::LOAD_DIV_STORE:
+            return Opcode::LOAD;
+        default:
+            return opcode;
+    }
+}
+
+const char* mnemonic(Opcode opcode) {
+    static const char *names[BASE_OPCODES] = {
+        "SET", "LOAD", "STORE", "ADD", "SUB", "MUL", "DIV", "PRINTLN",
+        "JMP", "JZ", "JNZ", "JGZ", "JLZ"
+    };
+    return names[static_cast<std::size_t>(baseOpcode(opcode))];
+}
+
+bool isJump(Opcode opcode) {
+    switch(opcode) {
+        case Opcode::JMP:
+        case Opcode::JZ:
+        case Opcode::JNZ:
+        case Opcode::JGZ:
+        case Opcode::JLZ:
+            return true;
+        default:
+            return false;
+    }
+}
+
+code_type& jumpTarget(Operation &operation) {
+    return operation.opcode == Opcode::JMP ? operation.first : operation.second;
+}
+
+code_type jumpTarget(const Operation &operation) {
+    return operation.opcode == Opcode::JMP ? operation.first : operation.second;
+}
+
+bool validOperands(const Operation &operation, const MachineLimits &machine) {
+    code_type first = operation.first;
+    code_type second = operation.second;
+
+    switch(operation.opcode) {
+        case Opcode::LOAD:
+        case Opcode::LOAD_ADD_STORE:
+        case Opcode::LOAD_SUB_STORE:
+        case Opcode::LOAD_MUL_STORE:
+        case Opcode::LOAD_DIV_STORE:
+            return machine.validRegister(first) && machine.validAddress(second);
+        case Opcode::STORE:
+            return machine.validAddress(first) && machine.validRegister(second);
+        case Opcode::ADD:
+        case Opcode::SUB:
+        case Opcode::MUL:
+        case Opcode::DIV:
+            return machine.validRegister(first) && machine.validRegister(second);
+        case Opcode::JMP:
+            return true;
+        default: // SET, PRINTLN and the conditional jumps
+            return machine.validRegister(first);
+    }
+}
+
+ExecutionContext::ExecutionContext(RegisterSet &registers, RAM &ram,
+                                   OutputSink &output)
+    : registers(registers), ram(ram), output(output), process{0}
+    , cache{nullptr} { }
+
 Instruction::~Instruction() { }
 
 SetInstruction::SetInstruction(register_type reg, number_type val)
     : reg{reg}, val{val} { }
 
-void SetInstruction::execute(RegisterSetPtr regs, RAMPtr) const {
-    regs->store(reg, val);
+void SetInstruction::execute(ExecutionContext &context) const {
+    context.registers.store(reg, val);
+}
+
+void SetInstruction::executeUnchecked(ExecutionContext &context) const {
+    context.registers.storeUnchecked(reg, val);
 }
 
 LoadInstruction::LoadInstruction(register_type dest, memory_type src)
     : dest{dest}, src{src} { }
 
-void LoadInstruction::execute(RegisterSetPtr regs, RAMPtr ram) const {
-    number_type val = ram->load(src);
-    regs->store(dest, val);
+void LoadInstruction::execute(ExecutionContext &context) const {
+    number_type val = context.ram.load(src);
+    context.registers.store(dest, val);
+    // Only the accesses of the instructions executed are modeled
+    if(context.cache)
+        context.cache->access(context.process, src);
+}
+
+void LoadInstruction::executeUnchecked(ExecutionContext &context) const {
+    number_type val = context.ram.loadUnchecked(src);
+    context.registers.storeUnchecked(dest, val);
+    if(context.cache)
+        context.cache->access(context.process, src);
 }
 
 StoreInstruction::StoreInstruction(memory_type dest, register_type src)
     : dest{dest}, src{src} { }
 
-void StoreInstruction::execute(RegisterSetPtr regs, RAMPtr ram) const {
-    number_type val = regs->load(src);
-    ram->store(dest, val);
+void StoreInstruction::execute(ExecutionContext &context) const {
+    number_type val = context.registers.load(src);
+    context.ram.store(dest, val);
+    if(context.cache)
+        context.cache->access(context.process, dest);
+}
+
+void StoreInstruction::executeUnchecked(ExecutionContext &context) const {
+    number_type val = context.registers.loadUnchecked(src);
+    context.ram.storeUnchecked(dest, val);
+    if(context.cache)
+        context.cache->access(context.process, dest);
 }
 
 PrintlnInstruction::PrintlnInstruction(register_type reg) : reg{reg} { }
 
-void PrintlnInstruction::execute(RegisterSetPtr regs, RAMPtr) const {
-    number_type val = regs->load(reg);
-    std::cout << val << std::endl;
+void PrintlnInstruction::execute(ExecutionContext &context) const {
+    number_type val = context.registers.load(reg);
+    context.output.println(context.process, val);
+}
+
+void PrintlnInstruction::executeUnchecked(ExecutionContext &context) const {
+    number_type val = context.registers.loadUnchecked(reg);
+    context.output.println(context.process, val);
 }
 } // namespace computer_internal
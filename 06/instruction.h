@@ -4,11 +4,84 @@
 #include <functional>
 #include "common.h"
 #include "memory.h"
+#include "output.h"
 
 namespace computer_internal {
+using code_type = number_type;
+
+// Forward declaration
+class CacheModel;
+
+enum class Opcode : code_type {
+    SET, LOAD, STORE, ADD, SUB, MUL, DIV, PRINTLN,
+    // Jumps to the target, unconditionally or if the register is zero, not
+    // zero, positive or negative
+    JMP, JZ, JNZ, JGZ, JLZ,
+
+    // Superinstructions. A superinstruction replaces the opcode of the first
+    // instruction of a fused sequence, the remaining instructions are left
+    // intact. Hence it behaves like its first instruction when executed
+    // alone, and the program can still be executed step by step.
+    SET_ADD, SET_SUB, SET_MUL, SET_DIV, // SET; arithmetic
+    LOAD_ADD_STORE, LOAD_SUB_STORE,     // LOAD; arithmetic; STORE
+    LOAD_MUL_STORE, LOAD_DIV_STORE
+};
+
+// The number of opcodes which are not superinstructions
+constexpr std::size_t BASE_OPCODES = 13;
+// The number of all the opcodes
+constexpr std::size_t OPCODES = BASE_OPCODES + 8;
+
+// The number of instructions executed by a single dispatch of the opcode
+// (i.e. the length of the fused sequence for superinstructions, 1 otherwise)
+time_type fusedLength(Opcode opcode);
+// The first instruction of the fused sequence (the opcode itself for the
+// other instructions)
+Opcode baseOpcode(Opcode opcode);
+// The name of the instruction in the source code
+const char* mnemonic(Opcode opcode);
+// Whether the instruction may be followed by another one than the next
+bool isJump(Opcode opcode);
+
+// A single instruction of the program image. The operands are stored in the
+// order in which they appear in the source code, e.g. SET R1 5 is encoded as
+// {Opcode::SET, 1, 5}
+struct Operation {
+    Opcode opcode;
+    code_type first;
+    code_type second;
+};
+
+// The index of the instruction the jump goes to, e.g. JMP loop is encoded as
+// {Opcode::JMP, target, 0} and JZ R1 loop as {Opcode::JZ, 1, target}
+code_type& jumpTarget(Operation &operation);
+code_type jumpTarget(const Operation &operation);
+
+// Whether the instruction accesses only the registers and memory cells the
+// machine has. Superinstructions are checked as their first instruction.
+// The jump targets are not checked, as they are resolved by the assembler.
+bool validOperands(const Operation &operation, const MachineLimits &machine);
+
+// A non-owning view of the state instructions operate on. It is created by
+// the CPU once per run, so executing an instruction does not touch any
+// reference counters
+struct ExecutionContext {
+    RegisterSet &registers;
+    RAM &ram;
+    OutputSink &output;
+    // The process being executed
+    pid_type process;
+    // Models the memory accesses, null if they are free
+    CacheModel *cache;
+
+    ExecutionContext(RegisterSet &registers, RAM &ram, OutputSink &output);
+};
+
+// The instructions can also be executed without the bounds checks, which is
+// only allowed when their operands have been validated beforehand
 class Instruction {
     public:
-    virtual void execute(RegisterSetPtr, RAMPtr) const = 0;
+    virtual void execute(ExecutionContext &context) const = 0;
     virtual ~Instruction();
 };
 
@@ -19,7 +92,8 @@ class SetInstruction : public Instruction {
 
     public:
     SetInstruction(register_type reg, number_type val);
-    virtual void execute(RegisterSetPtr regs, RAMPtr) const override;
+    virtual void execute(ExecutionContext &context) const override;
+    void executeUnchecked(ExecutionContext &context) const;
 };
 
 class LoadInstruction : public Instruction {
@@ -29,7 +103,8 @@ class LoadInstruction : public Instruction {
 
     public:
     LoadInstruction(register_type dest, memory_type src);
-    virtual void execute(RegisterSetPtr regs, RAMPtr ram) const override;
+    virtual void execute(ExecutionContext &context) const override;
+    void executeUnchecked(ExecutionContext &context) const;
 };
 
 class StoreInstruction : public Instruction {
@@ -39,7 +114,8 @@ class StoreInstruction : public Instruction {
 
     public:
     StoreInstruction(memory_type dest, register_type src);
-    virtual void execute(RegisterSetPtr regs, RAMPtr ram) const override;
+    virtual void execute(ExecutionContext &context) const override;
+    void executeUnchecked(ExecutionContext &context) const;
 };
 
 template<class Op>
@@ -52,11 +128,17 @@ class ArithmeticInstruction : public Instruction {
     public:
     ArithmeticInstruction(register_type dest, register_type src)
         : dest{dest}, src{src} { }
-    virtual void execute(RegisterSetPtr regs, RAMPtr) const override {
-        number_type rhs = regs->load(src);
-        number_type lhs = regs->load(dest);
+    virtual void execute(ExecutionContext &context) const override {
+        number_type rhs = context.registers.load(src);
+        number_type lhs = context.registers.load(dest);
+        number_type res = operation(lhs, rhs);
+        context.registers.store(dest, res);
+    }
+    void executeUnchecked(ExecutionContext &context) const {
+        number_type rhs = context.registers.loadUnchecked(src);
+        number_type lhs = context.registers.loadUnchecked(dest);
         number_type res = operation(lhs, rhs);
-        regs->store(dest, res);
+        context.registers.storeUnchecked(dest, res);
     }
 };
 
@@ -77,13 +159,37 @@ struct divides {
 
 using DivInstruction = ArithmeticInstruction<divides<long_number_type>>;
 
+// A conditional jump. It does not change the state of the machine, it only
+// tells whether the target is the next instruction to be executed.
+template<class Compare>
+class BranchInstruction {
+    private:
+    register_type reg;
+    Compare compare;
+
+    public:
+    explicit BranchInstruction(register_type reg) : reg{reg} { }
+    bool taken(ExecutionContext &context) const {
+        return compare(context.registers.load(reg), 0);
+    }
+    bool takenUnchecked(ExecutionContext &context) const {
+        return compare(context.registers.loadUnchecked(reg), 0);
+    }
+};
+
+using JzInstruction = BranchInstruction<std::equal_to<number_type>>;
+using JnzInstruction = BranchInstruction<std::not_equal_to<number_type>>;
+using JgzInstruction = BranchInstruction<std::greater<number_type>>;
+using JlzInstruction = BranchInstruction<std::less<number_type>>;
+
 class PrintlnInstruction : public Instruction {
     private:
     register_type reg;
 
     public:
     PrintlnInstruction(register_type reg);
-    virtual void execute(RegisterSetPtr regs, RAMPtr) const override;
+    virtual void execute(ExecutionContext &context) const override;
+    void executeUnchecked(ExecutionContext &context) const;
 };
 } // namespace computer_internal
 
@@ -0,0 +1,55 @@
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace computer_internal {
+MappedFile::MappedFile(const std::string &path)
+    : contents{nullptr}, length{0} {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        throw FileException(path, std::strerror(errno));
+
+    struct stat info;
+    if(fstat(fd, &info) < 0) {
+        int error = errno;
+        close(fd);
+        throw FileException(path, std::strerror(error));
+    }
+
+    length = static_cast<std::size_t>(info.st_size);
+    // An empty file cannot be mapped
+    if(length > 0) {
+        void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(address == MAP_FAILED) {
+            int error = errno;
+            close(fd);
+            throw FileException(path, std::strerror(error));
+        }
+
+        // The file is read once from the beginning to the end
+        madvise(address, length, MADV_SEQUENTIAL);
+        contents = static_cast<const char*>(address);
+    }
+
+    // The mapping outlives the descriptor
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if(contents)
+        munmap(const_cast<char*>(contents), length);
+}
+
+const char* MappedFile::data() const {
+    return contents;
+}
+
+std::size_t MappedFile::size() const {
+    return length;
+}
+} // namespace computer_internal
@@ -0,0 +1,27 @@
+#ifndef _MAPPED_FILE_H
+#define _MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include "common.h"
+
+namespace computer_internal {
+// The whole file mapped read-only into memory for the lifetime of the object
+class MappedFile {
+    private:
+    const char *contents;
+    std::size_t length;
+
+    public:
+    explicit MappedFile(const std::string &path);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    // Null for an empty file
+    const char* data() const;
+    std::size_t size() const;
+};
+} // namespace computer_internal
+
+#endif // _MAPPED_FILE_H
@@ -2,11 +2,40 @@
 #define _MEMORY_H
 
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include "common.h"
 
 namespace computer_internal {
+// A word of memory which may be accessed by many cores at once. Every load
+// and store is atomic, but no ordering between accesses to different words
+// is imposed (which costs nothing on the common architectures)
+template<class Value>
+class SharedCell {
+    private:
+    std::atomic<Value> value;
+
+    public:
+    SharedCell(Value val = Value{}) : value{val} { }
+    SharedCell(const SharedCell &that) : value{that} { }
+
+    SharedCell& operator=(const SharedCell &that) {
+        return *this = static_cast<Value>(that);
+    }
+
+    SharedCell& operator=(Value val) {
+        value.store(val, std::memory_order_relaxed);
+        return *this;
+    }
+
+    operator Value() const {
+        return value.load(std::memory_order_relaxed);
+    }
+};
+
 template<unsigned From, class Index, class Value, class Exception>
 class Memory {
     private:
@@ -35,13 +64,269 @@ class Memory {
         return get(idx);
     }
 
+    // The index has to be valid
+    void storeUnchecked(Index idx, Value val) {
+        mem[idx - From] = val;
+    }
+
+    Value loadUnchecked(Index idx) {
+        return mem[idx - From];
+    }
+
+    Index size() const {
+        return static_cast<Index>(mem.size());
+    }
+
+    // The contiguous storage, the first index comes first
+    Value* data() {
+        return mem.data();
+    }
+
     void clear() {
         std::fill(mem.begin(), mem.end(), 0);
     }
 };
 
+// Memory divided into pages which are allocated (zero-filled) on the first
+// write, so only the pages actually touched take any space. The pages are
+// found using a two-level page table.
+//
+// Copies share the whole page table, which is copied on write (one node
+// per level at a time), so copying takes constant time and only the pages
+// written by either copy get duplicated. Many cores may access the memory
+// at once: the loads and the stores to pages owned exclusively go without
+// locking, anything else takes the slow path guarded by the mutex.
+template<unsigned From, class Index, class Value, class Exception>
+class PagedMemory {
+    private:
+    constexpr static const unsigned PAGE_BITS = 10;
+    constexpr static const unsigned TABLE_BITS = 10;
+    constexpr static const std::size_t PAGE_SIZE = std::size_t{1} << PAGE_BITS;
+    constexpr static const std::size_t TABLE_SIZE = std::size_t{1} << TABLE_BITS;
+
+    // A reference-counted node of the page table
+    struct Node {
+        std::atomic<long> refs;
+
+        Node() : refs{1} { }
+        Node(const Node&) : refs{1} { }
+        virtual ~Node() { }
+
+        bool exclusive() const {
+            return refs.load(std::memory_order_acquire) == 1;
+        }
+
+        static void acquire(Node *node) {
+            if(node)
+                node->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        static void release(Node *node) {
+            if(node && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete node;
+        }
+    };
+
+    // A node holding the (shared) pointers to its children
+    template<class Child>
+    struct Level : Node {
+        std::size_t count;
+        std::unique_ptr<std::atomic<Child*>[]> children;
+
+        explicit Level(std::size_t count)
+            : count{count}, children{new std::atomic<Child*>[count]} {
+            for(std::size_t i = 0; i < count; ++i)
+                children[i].store(nullptr, std::memory_order_relaxed);
+        }
+
+        Level(const Level &that) : Node(that), count{that.count},
+            children{new std::atomic<Child*>[that.count]} {
+            for(std::size_t i = 0; i < count; ++i) {
+                Child *child = that.children[i].load(std::memory_order_acquire);
+                Node::acquire(child);
+                children[i].store(child, std::memory_order_relaxed);
+            }
+        }
+
+        virtual ~Level() {
+            for(std::size_t i = 0; i < count; ++i)
+                Node::release(children[i].load(std::memory_order_relaxed));
+        }
+    };
+
+    struct Page : Node {
+        SharedCell<Value> words[PAGE_SIZE];
+    };
+
+    struct Table : Level<Page> {
+        Table() : Level<Page>{TABLE_SIZE} { }
+    };
+
+    using Directory = Level<Table>;
+
+    Index length;
+    std::size_t tables;
+    std::atomic<Directory*> root;
+
+    // Guards the slow path of stores
+    std::mutex lock;
+    // The nodes replaced by their private copies. Other cores may still be
+    // using them, so they are released only when the memory is not used
+    std::vector<Node*> retired;
+
+    std::size_t offset(Index idx) const {
+        Index aligned = idx - From;
+        if(aligned < 0 || aligned >= length)
+            throw Exception(idx);
+
+        return aligned;
+    }
+
+    static std::size_t tableIndex(std::size_t word) {
+        return word >> (PAGE_BITS + TABLE_BITS);
+    }
+
+    static std::size_t pageIndex(std::size_t word) {
+        return (word >> PAGE_BITS) & (TABLE_SIZE - 1);
+    }
+
+    static std::size_t wordIndex(std::size_t word) {
+        return word & (PAGE_SIZE - 1);
+    }
+
+    // Makes the node in the slot owned exclusively by this memory (creating
+    // it from the arguments if needed). Requires the lock to be held.
+    template<class T, class... Args>
+    T* own(std::atomic<T*> &slot, Args&&... args) {
+        T *node = slot.load(std::memory_order_acquire);
+        if(node && node->exclusive())
+            return node;
+
+        T *created;
+        if(node) {
+            created = new T(*node);
+            retired.push_back(node);
+        }
+        else
+            created = new T(std::forward<Args>(args)...);
+
+        slot.store(created, std::memory_order_release);
+        return created;
+    }
+
+    Page& writable(std::size_t word) {
+        std::lock_guard<std::mutex> guard{lock};
+        Directory *directory = own(root, tables);
+        Table *table = own(directory->children[tableIndex(word)]);
+        return *own(table->children[pageIndex(word)]);
+    }
+
+    // Requires the memory not to be used by anyone else
+    void collect() {
+        for(Node *node : retired)
+            Node::release(node);
+        retired.clear();
+    }
+
+    void storeWord(std::size_t word, Value val) {
+        Directory *directory = root.load(std::memory_order_acquire);
+        Table *table = directory->children[tableIndex(word)]
+            .load(std::memory_order_acquire);
+        Page *page = table ? table->children[pageIndex(word)]
+            .load(std::memory_order_acquire) : nullptr;
+
+        if(!page || !directory->exclusive() || !table->exclusive()
+                 || !page->exclusive())
+            page = &writable(word);
+
+        page->words[wordIndex(word)] = val;
+    }
+
+    Value loadWord(std::size_t word) {
+        Directory *directory = root.load(std::memory_order_acquire);
+        Table *table = directory->children[tableIndex(word)]
+            .load(std::memory_order_acquire);
+        if(!table)
+            return Value{};
+
+        Page *page = table->children[pageIndex(word)]
+            .load(std::memory_order_acquire);
+        if(!page)
+            return Value{};
+
+        return page->words[wordIndex(word)];
+    }
+
+    public:
+    PagedMemory(Index size) : length{size}, tables{0}, root{nullptr} {
+        if(size <= 0)
+            throw IllegalArgumentException("Negative size provided");
+
+        constexpr std::size_t covered = PAGE_SIZE * TABLE_SIZE;
+        tables = (static_cast<std::size_t>(size) + covered - 1) / covered;
+        root.store(new Directory{tables}, std::memory_order_relaxed);
+    }
+
+    PagedMemory(const PagedMemory &that)
+        : length{that.length}
+        , tables{that.tables}
+        , root{that.root.load(std::memory_order_acquire)} {
+        Node::acquire(root.load(std::memory_order_relaxed));
+    }
+
+    PagedMemory& operator=(const PagedMemory &that) {
+        Directory *directory = that.root.load(std::memory_order_acquire);
+        Node::acquire(directory);
+        Node::release(root.exchange(directory));
+        collect();
+        length = that.length;
+        tables = that.tables;
+        return *this;
+    }
+
+    ~PagedMemory() {
+        Node::release(root.load(std::memory_order_relaxed));
+        collect();
+    }
+
+    void store(Index idx, Value val) {
+        storeWord(offset(idx), val);
+    }
+
+    Value load(Index idx) {
+        return loadWord(offset(idx));
+    }
+
+    // The index has to be valid
+    void storeUnchecked(Index idx, Value val) {
+        storeWord(idx - From, val);
+    }
+
+    Value loadUnchecked(Index idx) {
+        return loadWord(idx - From);
+    }
+
+    Index size() const {
+        return length;
+    }
+
+    // Drops all the pages. Other copies are not affected.
+    void clear() {
+        Node::release(root.exchange(new Directory{tables}));
+        collect();
+    }
+
+    // Frees the parts of the page table replaced since the last call. Must
+    // not be called while any core is using the memory.
+    void compact() {
+        std::lock_guard<std::mutex> guard{lock};
+        collect();
+    }
+};
+
 using RegisterSet = Memory<1, register_type, number_type, InvalidRegisterException>;
-using RAM = Memory<0, memory_type, number_type, InvalidAddressException>;
+// The RAM is shared by all the cores of the computer
+using RAM = PagedMemory<0, memory_type, number_type, InvalidAddressException>;
 
 using RegisterSetPtr = std::shared_ptr<RegisterSet>;
 using RAMPtr = std::shared_ptr<RAM>;
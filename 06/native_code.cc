@@ -0,0 +1,390 @@
+#include "native_code.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <sys/mman.h>
+#include "cache_model.h"
+
+namespace computer_internal {
+// The registers of the machine are addressed relative to rbx, the frame is
+// kept in r13 and the number of cycles left in r12. All three are
+// preserved by the helpers.
+
+constexpr Program::size_type NativeCode::BLOCK;
+
+void NativeCode::Emitter::bytes(std::initializer_list<uint8_t> values) {
+    code.insert(code.end(), values.begin(), values.end());
+}
+
+void NativeCode::Emitter::dword(uint32_t value) {
+    for(unsigned i = 0; i < 4; ++i)
+        code.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+void NativeCode::Emitter::qword(uint64_t value) {
+    dword(static_cast<uint32_t>(value));
+    dword(static_cast<uint32_t>(value >> 32));
+}
+
+void NativeCode::Emitter::operand(uint8_t field, register_type reg) {
+    auto displacement = static_cast<uint32_t>((reg - 1) * sizeof(number_type));
+    // [rbx + disp8] or [rbx + disp32]
+    if(displacement < 128)
+        bytes({static_cast<uint8_t>(0x43 | field << 3),
+               static_cast<uint8_t>(displacement)});
+    else {
+        bytes({static_cast<uint8_t>(0x83 | field << 3)});
+        dword(displacement);
+    }
+}
+
+void NativeCode::Emitter::jump(std::initializer_list<uint8_t> opcode,
+                               Label label) {
+    bytes(opcode);
+    jumps.emplace_back(code.size(), label);
+    dword(0);
+}
+
+void NativeCode::Emitter::call(const void *helper) {
+    bytes({0x48, 0xB8});                // mov rax, helper
+    qword(reinterpret_cast<uint64_t>(helper));
+    bytes({0xFF, 0xD0});                // call rax
+    bytes({0x84, 0xC0});                // test al, al
+    jump({0x0F, 0x84}, HELPER_FAULT);   // jz HELPER_FAULT
+}
+
+void NativeCode::Emitter::bind(Label label) {
+    labels[label] = code.size();
+}
+
+std::size_t NativeCode::Emitter::size() const {
+    return code.size();
+}
+
+const std::vector<uint8_t>& NativeCode::Emitter::finish() {
+    for(const auto &jump : jumps) {
+        // Relative to the end of the displacement
+        auto displacement = static_cast<uint32_t>(
+            labels[jump.second] - (jump.first + 4));
+        std::memcpy(&code[jump.first], &displacement, sizeof(displacement));
+    }
+    return code;
+}
+
+NativeCode::NativeCode(void *code, std::size_t length,
+                       std::vector<uint32_t> entries,
+                       std::vector<uint64_t> rest)
+    : code{code}, length{length}, entries(std::move(entries))
+    , rest(std::move(rest)) { }
+
+void* NativeCode::map(const std::vector<uint8_t> &machine_code) {
+    // The code is never writable and executable at once
+    std::size_t length = machine_code.size();
+    void *address = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(address == MAP_FAILED)
+        return nullptr;
+
+    std::memcpy(address, machine_code.data(), length);
+    if(mprotect(address, length, PROT_READ | PROT_EXEC) != 0) {
+        munmap(address, length);
+        return nullptr;
+    }
+    return address;
+}
+
+NativeCode::~NativeCode() {
+    munmap(code, length);
+}
+
+bool NativeCode::translatable(const Operation &operation) {
+    if(isJump(operation.opcode))
+        return false;
+
+    // The displacements of the registers have to fit in 32 bits
+    auto farthest = std::numeric_limits<int32_t>::max() / sizeof(number_type);
+    switch(baseOpcode(operation.opcode)) {
+        case Opcode::STORE:
+            return static_cast<std::size_t>(operation.second) <= farthest;
+        case Opcode::ADD:
+        case Opcode::SUB:
+        case Opcode::MUL:
+        case Opcode::DIV:
+            return static_cast<std::size_t>(operation.first) <= farthest
+                && static_cast<std::size_t>(operation.second) <= farthest;
+        default: // SET, LOAD and PRINTLN
+            return static_cast<std::size_t>(operation.first) <= farthest;
+    }
+}
+
+void NativeCode::emitPrologue(Emitter &emitter) {
+    static_assert(offsetof(Frame, registers) == 0
+                  && offsetof(Frame, position) < 128,
+                  "The frame does not match the machine code");
+    auto left = static_cast<uint8_t>(offsetof(Frame, left));
+
+    // Three pushes keep the stack aligned for the calls
+    emitter.bytes({0x53});              // push rbx
+    emitter.bytes({0x41, 0x54});        // push r12
+    emitter.bytes({0x41, 0x55});        // push r13
+    emitter.bytes({0x49, 0x89, 0xFD});  // mov r13, rdi
+    emitter.bytes({0x48, 0x8B, 0x1F});  // mov rbx, [rdi + registers]
+    emitter.bytes({0x4C, 0x8B, 0x67, left}); // mov r12, [rdi + left]
+    emitter.bytes({0xFF, 0xE6});        // jmp rsi
+}
+
+void NativeCode::emitPosition(Emitter &emitter, Program::size_type position) {
+    auto field = static_cast<uint8_t>(offsetof(Frame, position));
+    emitter.bytes({0x49, 0xC7, 0x45, field}); // mov qword [r13 + position],
+    emitter.dword(static_cast<uint32_t>(position)); //     position
+}
+
+void NativeCode::emitBlock(Emitter &emitter, Program::size_type start,
+                           uint64_t cycles) {
+    // The block is left at its start unless all of it may be executed
+    emitPosition(emitter, start);
+    if(cycles < 128) {
+        auto immediate = static_cast<uint8_t>(cycles);
+        emitter.bytes({0x49, 0x83, 0xFC, immediate}); // cmp r12, cycles
+        emitter.jump({0x0F, 0x82}, END);              // jb END
+        emitter.bytes({0x49, 0x83, 0xEC, immediate}); // sub r12, cycles
+    }
+    else {
+        emitter.bytes({0x48, 0xB8});        // mov rax, cycles
+        emitter.qword(cycles);
+        emitter.bytes({0x49, 0x39, 0xC4});  // cmp r12, rax
+        emitter.jump({0x0F, 0x82}, END);    // jb END
+        emitter.bytes({0x49, 0x29, 0xC4});  // sub r12, rax
+    }
+}
+
+void NativeCode::emitInstruction(Emitter &emitter, const Operation &operation) {
+    register_type first = operation.first;
+    register_type second = operation.second;
+
+    // The ModRM fields of the registers of the host
+    const uint8_t EAX = 0, ECX = 1, EDX = 2, ESI = 6;
+
+    // Superinstructions are executed instruction by instruction
+    switch(baseOpcode(operation.opcode)) {
+        case Opcode::SET:
+            emitter.bytes({0xC7});          // mov dword [first], second
+            emitter.operand(EAX, first);
+            emitter.dword(static_cast<uint32_t>(second));
+            break;
+        case Opcode::LOAD:
+            emitter.bytes({0x4C, 0x89, 0xEF}); // mov rdi, r13
+            emitter.bytes({0xBE});          // mov esi, second
+            emitter.dword(static_cast<uint32_t>(second));
+            emitter.bytes({0x48, 0x8D});    // lea rdx, [first]
+            emitter.operand(EDX, first);
+            emitter.call(reinterpret_cast<const void*>(&NativeCode::load));
+            break;
+        case Opcode::STORE:
+            emitter.bytes({0x4C, 0x89, 0xEF}); // mov rdi, r13
+            emitter.bytes({0xBE});          // mov esi, first
+            emitter.dword(static_cast<uint32_t>(first));
+            emitter.bytes({0x8B});          // mov edx, [second]
+            emitter.operand(EDX, second);
+            emitter.call(reinterpret_cast<const void*>(&NativeCode::store));
+            break;
+        // The 32-bit arithmetic wraps around just like the truncated 64-bit
+        // one of the interpreter
+        case Opcode::ADD:
+            emitter.bytes({0x8B});          // mov eax, [second]
+            emitter.operand(EAX, second);
+            emitter.bytes({0x01});          // add [first], eax
+            emitter.operand(EAX, first);
+            break;
+        case Opcode::SUB:
+            emitter.bytes({0x8B});          // mov eax, [second]
+            emitter.operand(EAX, second);
+            emitter.bytes({0x29});          // sub [first], eax
+            emitter.operand(EAX, first);
+            break;
+        case Opcode::MUL:
+            emitter.bytes({0x8B});          // mov eax, [first]
+            emitter.operand(EAX, first);
+            emitter.bytes({0x0F, 0xAF});    // imul eax, [second]
+            emitter.operand(EAX, second);
+            emitter.bytes({0x89});          // mov [first], eax
+            emitter.operand(EAX, first);
+            break;
+        case Opcode::DIV:
+            // Divided in 64 bits, so that the minimal value divided by -1
+            // does not trap
+            emitter.bytes({0x48, 0x63});    // movsxd rcx, [second]
+            emitter.operand(ECX, second);
+            emitter.bytes({0x48, 0x85, 0xC9}); // test rcx, rcx
+            emitter.jump({0x0F, 0x84}, DIVISION_FAULT); // jz DIVISION_FAULT
+            emitter.bytes({0x48, 0x63});    // movsxd rax, [first]
+            emitter.operand(EAX, first);
+            emitter.bytes({0x48, 0x99});    // cqo
+            emitter.bytes({0x48, 0xF7, 0xF9}); // idiv rcx
+            emitter.bytes({0x89});          // mov [first], eax
+            emitter.operand(EAX, first);
+            break;
+        default: // PRINTLN
+            emitter.bytes({0x4C, 0x89, 0xEF}); // mov rdi, r13
+            emitter.bytes({0x8B});          // mov esi, [first]
+            emitter.operand(ESI, first);
+            emitter.call(reinterpret_cast<const void*>(&NativeCode::println));
+            break;
+    }
+}
+
+void NativeCode::emitEpilogue(Emitter &emitter) {
+    auto left = static_cast<uint8_t>(offsetof(Frame, left));
+
+    // Reached after the last translated instruction or at the start of a
+    // block there is not enough time left for
+    emitter.bind(END);
+    emitter.bytes({0xB8});                  // mov eax, FINISHED
+    emitter.dword(FINISHED);
+    std::size_t leave = emitter.size();
+    emitter.bytes({0x4D, 0x89, 0x65, left}); // mov [r13 + left], r12
+    emitter.bytes({0x41, 0x5D});            // pop r13
+    emitter.bytes({0x41, 0x5C});            // pop r12
+    emitter.bytes({0x5B});                  // pop rbx
+    emitter.bytes({0xC3});                  // ret
+
+    // The jumps back to the leave sequence are short
+    auto back = [&emitter, leave]() {
+        emitter.bytes({0xEB, static_cast<uint8_t>(
+            leave - (emitter.size() + 2))}); // jmp leave
+    };
+
+    emitter.bind(DIVISION_FAULT);
+    emitter.bytes({0xB8});                  // mov eax, DIVISION_BY_ZERO
+    emitter.dword(DIVISION_BY_ZERO);
+    back();
+
+    emitter.bind(HELPER_FAULT);
+    emitter.bytes({0xB8});                  // mov eax, EXCEPTION
+    emitter.dword(EXCEPTION);
+    back();
+}
+
+bool NativeCode::load(Frame *frame, memory_type address,
+                      number_type *destination) noexcept {
+    try {
+        *destination = frame->ram->loadUnchecked(address);
+        if(frame->context->cache)
+            frame->context->cache->access(frame->context->process, address);
+        return true;
+    }
+    catch(...) {
+        *frame->error = std::current_exception();
+        return false;
+    }
+}
+
+bool NativeCode::store(Frame *frame, memory_type address,
+                       number_type value) noexcept {
+    try {
+        frame->ram->storeUnchecked(address, value);
+        if(frame->context->cache)
+            frame->context->cache->access(frame->context->process, address);
+        return true;
+    }
+    catch(...) {
+        *frame->error = std::current_exception();
+        return false;
+    }
+}
+
+bool NativeCode::println(Frame *frame, number_type value) noexcept {
+    try {
+        frame->context->output.println(frame->context->process, value);
+        return true;
+    }
+    catch(...) {
+        *frame->error = std::current_exception();
+        return false;
+    }
+}
+
+NativeCodePtr NativeCode::translate(const Program &program,
+                                    Program::size_type validated,
+                                    const CycleCosts &costs) {
+    if(!NATIVE_CODE_SUPPORTED)
+        return nullptr;
+
+    // The positions are stored as 32-bit immediates
+    Program::size_type size = 0;
+    while(size < validated && size < std::numeric_limits<int32_t>::max()
+            && translatable(program[size]))
+        ++size;
+    if(size == 0)
+        return nullptr;
+
+    std::vector<uint64_t> rest(size);
+    for(Program::size_type i = size; i-- > 0; ) {
+        rest[i] = costs.get(program[i].opcode);
+        if((i + 1) % BLOCK != 0 && i + 1 < size)
+            rest[i] += rest[i + 1];
+    }
+
+    Emitter emitter;
+    std::vector<uint32_t> entries;
+    entries.reserve(size);
+
+    emitPrologue(emitter);
+    for(Program::size_type i = 0; i < size; ++i) {
+        // The first block is paid for on the entry
+        if(i % BLOCK == 0 && i > 0)
+            emitBlock(emitter, i, rest[i]);
+        if(emitter.size() > std::numeric_limits<uint32_t>::max())
+            return nullptr;
+        entries.push_back(static_cast<uint32_t>(emitter.size()));
+        emitInstruction(emitter, program[i]);
+    }
+    emitPosition(emitter, size);
+    emitEpilogue(emitter);
+
+    // The interpreter is used if the host does not allow for executable
+    // memory
+    const std::vector<uint8_t> &machine_code = emitter.finish();
+    void *code = map(machine_code);
+    if(!code)
+        return nullptr;
+    return NativeCodePtr(new NativeCode(code, machine_code.size(),
+                                        std::move(entries), std::move(rest)));
+}
+
+Program::size_type NativeCode::size() const {
+    return entries.size();
+}
+
+std::size_t NativeCode::bytes() const {
+    return sizeof(*this) + length + entries.capacity() * sizeof(uint32_t)
+        + rest.capacity() * sizeof(uint64_t);
+}
+
+bool NativeCode::runnable(Program::size_type ip, int64_t left) const {
+    return ip < size() && left >= 0 && static_cast<uint64_t>(left) >= rest[ip];
+}
+
+Program::size_type NativeCode::run(Program::size_type ip, int64_t &left,
+                                   ExecutionContext &context) const {
+    // The rest of the block entered is paid for in advance
+    std::exception_ptr error;
+    Frame frame{context.registers.data(), &context.ram, &context,
+                static_cast<uint64_t>(left) - rest[ip], ip, &error};
+
+    auto function = reinterpret_cast<function_type>(code);
+    uint32_t status = function(&frame,
+                               static_cast<const char*>(code) + entries[ip]);
+
+    // Thrown before anything is accounted, like by the interpreter
+    if(status == DIVISION_BY_ZERO)
+        throw DivisionByZeroException();
+    if(status == EXCEPTION)
+        std::rethrow_exception(error);
+
+    left = static_cast<int64_t>(frame.left);
+    return frame.position;
+}
+} // namespace computer_internal
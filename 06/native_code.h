@@ -0,0 +1,151 @@
+#ifndef _NATIVE_CODE_H
+#define _NATIVE_CODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "common.h"
+#include "cycle_costs.h"
+#include "instruction.h"
+#include "memory.h"
+#include "process.h"
+
+namespace computer_internal {
+// Whether the programs can be translated into the machine code of the host
+#if defined(__x86_64__) && defined(__linux__)
+constexpr bool NATIVE_CODE_SUPPORTED = true;
+#else
+constexpr bool NATIVE_CODE_SUPPORTED = false;
+#endif
+
+class NativeCode;
+using NativeCodePtr = std::shared_ptr<const NativeCode>;
+
+// The x86-64 machine code of the leading straight-line part of a program,
+// made of a fixed template per instruction. The registers are accessed in
+// place in the RegisterSet, the RAM and the output through the helpers.
+//
+// The code may be entered at any of the translated instructions. It is
+// divided into blocks of BLOCK instructions, and it is left at the start of
+// the first block there are not enough cycles left for, so that checking
+// the timer costs next to nothing; the rest of the time slice is left to
+// the interpreter. The cycles of the blocks are a part of the code. The
+// faults are returned by the machine code and thrown as the same exceptions
+// once it is left. The operands are validated before the translation, hence
+// there are no bounds checks.
+class NativeCode {
+    private:
+    // The state passed to the machine code, the templates rely on its layout
+    struct Frame {
+        number_type *registers;
+        RAM *ram;
+        ExecutionContext *context;
+        uint64_t left;
+        // The instruction the code was left at
+        uint64_t position;
+        // Thrown by a helper
+        std::exception_ptr *error;
+    };
+
+    // Returned by the machine code
+    enum Status : uint32_t { FINISHED, DIVISION_BY_ZERO, EXCEPTION };
+
+    using function_type = uint32_t (*)(Frame *frame, const void *entry);
+
+    // The points of the code the templates jump to
+    enum Label { END, DIVISION_FAULT, HELPER_FAULT, LABELS };
+
+    static constexpr Program::size_type BLOCK = 32;
+
+    // Builds the machine code in an ordinary buffer
+    class Emitter {
+        private:
+        std::vector<uint8_t> code;
+        std::size_t labels[LABELS];
+        // The displacements to patch and the labels they refer to
+        std::vector<std::pair<std::size_t, Label>> jumps;
+
+        public:
+        void bytes(std::initializer_list<uint8_t> values);
+        void dword(uint32_t value);
+        void qword(uint64_t value);
+        // The ModRM byte of the register of the machine (addressed by rbx)
+        // and the register of the host in the field, with the displacement
+        void operand(uint8_t field, register_type reg);
+        // The opcode followed by the 32-bit displacement of the label
+        void jump(std::initializer_list<uint8_t> opcode, Label label);
+        // Calls the helper and leaves the code if it fails
+        void call(const void *helper);
+        void bind(Label label);
+        std::size_t size() const;
+        // Resolves the jumps
+        const std::vector<uint8_t>& finish();
+    };
+
+    void *code;
+    std::size_t length;
+    // The offset of the template of every translated instruction
+    std::vector<uint32_t> entries;
+    // The cycles from every translated instruction to the end of its block
+    std::vector<uint64_t> rest;
+
+    NativeCode(void *code, std::size_t length, std::vector<uint32_t> entries,
+               std::vector<uint64_t> rest);
+    // Copies the machine code to executable memory, null on failure
+    static void* map(const std::vector<uint8_t> &machine_code);
+
+    // Whether the instruction has a template
+    static bool translatable(const Operation &operation);
+    static void emitPrologue(Emitter &emitter);
+    // Stores the position the code is left at
+    static void emitPosition(Emitter &emitter, Program::size_type position);
+    // The check of the cycles left made at the start of every block but the
+    // first one
+    static void emitBlock(Emitter &emitter, Program::size_type start,
+                          uint64_t cycles);
+    static void emitInstruction(Emitter &emitter, const Operation &operation);
+    static void emitEpilogue(Emitter &emitter);
+
+    // The helpers called by the machine code. They never throw, a failure is
+    // stored in the frame instead.
+    static bool load(Frame *frame, memory_type address,
+                     number_type *destination) noexcept;
+    static bool store(Frame *frame, memory_type address,
+                      number_type value) noexcept;
+    static bool println(Frame *frame, number_type value) noexcept;
+
+    public:
+    NativeCode(const NativeCode&) = delete;
+    NativeCode& operator=(const NativeCode&) = delete;
+    ~NativeCode();
+
+    // Translates the program up to the first jump, for the machine with the
+    // given costs. The validated leading instructions have to have valid
+    // operands and only they are translated. Null if there is nothing to
+    // translate or the host is not supported.
+    static NativeCodePtr translate(const Program &program,
+                                   Program::size_type validated,
+                                   const CycleCosts &costs = CycleCosts{});
+
+    // The number of the translated instructions
+    Program::size_type size() const;
+    // The memory taken by the machine code
+    std::size_t bytes() const;
+
+    // Whether the instruction is translated and the rest of its block may
+    // be executed in the given cycles
+    bool runnable(Program::size_type ip, int64_t left) const;
+    // Executes the translated instructions from ip on (which has to be
+    // runnable), until the end of the translated part or the first block
+    // there are not enough cycles left for. Returns the position of the
+    // next instruction.
+    Program::size_type run(Program::size_type ip, int64_t &left,
+                           ExecutionContext &context) const;
+};
+} // namespace computer_internal
+
+#endif // _NATIVE_CODE_H
@@ -0,0 +1,156 @@
+#include "object_file.h"
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+namespace computer_internal {
+constexpr char ObjectFile::MAGIC[4];
+constexpr uint32_t ObjectFile::ORDER_MARK;
+constexpr uint32_t ObjectFile::FUSED;
+constexpr uint32_t ObjectFile::OPTIMIZED;
+constexpr uint32_t ObjectFile::VERSION;
+
+ObjectFile::ObjectFile() { }
+
+bool ObjectFile::validFusion(const Program &program, Program::size_type i) {
+    Opcode opcode = program[i].opcode;
+    Program::size_type length = fusedLength(opcode);
+    if(length == 1)
+        return true;
+    if(i + length > program.size())
+        return false;
+
+    Opcode arithmetic = program[i + 1].opcode;
+    switch(opcode) {
+        case Opcode::SET_ADD:
+        case Opcode::LOAD_ADD_STORE:
+            if(arithmetic != Opcode::ADD)
+                return false;
+            break;
+        case Opcode::SET_SUB:
+        case Opcode::LOAD_SUB_STORE:
+            if(arithmetic != Opcode::SUB)
+                return false;
+            break;
+        case Opcode::SET_MUL:
+        case Opcode::LOAD_MUL_STORE:
+            if(arithmetic != Opcode::MUL)
+                return false;
+            break;
+        default:
+            if(arithmetic != Opcode::DIV)
+                return false;
+            break;
+    }
+
+    return length == 2 || program[i + 2].opcode == Opcode::STORE;
+}
+
+bool ObjectFile::validJump(const Program &program, Program::size_type i) {
+    if(!isJump(program[i].opcode))
+        return true;
+
+    // Jumping right past the last instruction ends the process
+    code_type target = jumpTarget(program[i]);
+    return target >= 0
+        && static_cast<Program::size_type>(target) <= program.size();
+}
+
+void ObjectFile::write(const Program &program,
+                       const CompilationOptions &options,
+                       const MachineLimits &machine,
+                       std::ostream &stream) {
+    static_assert(sizeof(Record) == 3 * sizeof(int32_t),
+                  "The records have to be packed");
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byte_order = ORDER_MARK;
+    header.flags = (options.fuse_instructions ? FUSED : 0)
+        | (options.optimize ? OPTIMIZED : 0);
+    header.registers = options.optimize ? machine.registers : 0;
+    header.memory = options.optimize ? machine.memory : 0;
+    header.instructions = program.size();
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<Record> records;
+    records.reserve(program.size());
+    for(const Operation &op : program)
+        records.push_back({static_cast<int32_t>(op.opcode),
+                           op.first, op.second});
+    stream.write(reinterpret_cast<const char*>(records.data()),
+                 records.size() * sizeof(Record));
+}
+
+void ObjectFile::writeFile(const Program &program,
+                           const CompilationOptions &options,
+                           const MachineLimits &machine,
+                           const std::string &path) {
+    std::ofstream stream{path, std::ios::binary | std::ios::trunc};
+    if(stream)
+        write(program, options, machine, stream);
+    if(stream)
+        stream.close();
+    if(!stream)
+        throw FileException(path, std::strerror(errno), "write");
+}
+
+ProgramPtr ObjectFile::load(const char *data, std::size_t size,
+                            const MachineLimits &machine, bool optimized) {
+    Header header;
+    if(size < sizeof(header))
+        throw InvalidObjectException("Truncated header");
+    std::memcpy(&header, data, sizeof(header));
+
+    if(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+        throw InvalidObjectException("Not an object file");
+    if(header.version != VERSION)
+        throw InvalidObjectException("Unsupported version "
+                                     + std::to_string(header.version));
+    if(header.byte_order != ORDER_MARK)
+        throw InvalidObjectException("Incompatible byte order");
+    if((header.flags & OPTIMIZED) && (header.registers != machine.registers
+                                      || header.memory != machine.memory))
+        throw InvalidObjectException("Optimized for a different machine");
+    if((header.flags & OPTIMIZED) && !optimized)
+        throw InvalidObjectException("Optimized programs not accepted");
+    if(header.instructions != (size - sizeof(header)) / sizeof(Record)
+            || (size - sizeof(header)) % sizeof(Record) != 0)
+        throw InvalidObjectException("Size does not match the header");
+
+    auto program = std::make_shared<Program>(header.instructions);
+    const char *records = data + sizeof(header);
+    for(Program::size_type i = 0; i < program->size(); ++i) {
+        Record record;
+        std::memcpy(&record, records + i * sizeof(Record), sizeof(Record));
+        if(record.opcode < 0
+                || record.opcode > static_cast<int32_t>(Opcode::LOAD_DIV_STORE))
+            throw InvalidObjectException("Unknown opcode "
+                                         + std::to_string(record.opcode));
+
+        (*program)[i] = {static_cast<Opcode>(record.opcode),
+                         record.first, record.second};
+    }
+
+    for(Program::size_type i = 0; i < program->size(); ++i) {
+        if(!validFusion(*program, i))
+            throw InvalidObjectException("Malformed superinstruction at "
+                                         + std::to_string(i));
+        if(!validJump(*program, i))
+            throw InvalidObjectException("Jump out of the program at "
+                                         + std::to_string(i));
+    }
+
+    return program;
+}
+
+ProgramPtr ObjectFile::loadFile(const std::string &path,
+                                const MachineLimits &machine,
+                                bool optimized) {
+    MappedFile file{path};
+    return load(file.data(), file.size(), machine, optimized);
+}
+} // namespace computer_internal
@@ -0,0 +1,76 @@
+#ifndef _OBJECT_FILE_H
+#define _OBJECT_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include "assembler.h"
+#include "common.h"
+#include "instruction.h"
+#include "process.h"
+
+namespace computer_internal {
+// The binary format of the assembled programs. An object file consists of
+// the header followed by the program image, three 32-bit words (the opcode
+// and the operands) per instruction, in the byte order of the host. The
+// image is loaded as it is, without parsing.
+class ObjectFile {
+    private:
+    ObjectFile(); // Singleton class
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        // Tells the byte order of the file apart
+        uint32_t byte_order;
+        uint32_t flags;
+        // The machine the program was optimized for
+        int32_t registers;
+        int32_t memory;
+        uint64_t instructions;
+    };
+
+    struct Record {
+        int32_t opcode;
+        int32_t first;
+        int32_t second;
+    };
+
+    static constexpr char MAGIC[4] = {'C', 'O', 'B', 'J'};
+    static constexpr uint32_t ORDER_MARK = 0x01020304;
+    static constexpr uint32_t FUSED = 1;
+    static constexpr uint32_t OPTIMIZED = 2;
+
+    // Whether the superinstruction is followed by the instructions it fuses
+    static bool validFusion(const Program &program, Program::size_type i);
+    // Whether the instruction is not a jump outside of the program
+    static bool validJump(const Program &program, Program::size_type i);
+
+    public:
+    static constexpr uint32_t VERSION = 2;
+
+    // The options and the machine are those the program was compiled with
+    static void write(const Program &program,
+                      const CompilationOptions &options,
+                      const MachineLimits &machine,
+                      std::ostream &stream);
+    static void writeFile(const Program &program,
+                          const CompilationOptions &options,
+                          const MachineLimits &machine,
+                          const std::string &path);
+
+    // A program optimized for a different machine is rejected, since the
+    // optimizer relies on the limits of the machine, and so is any optimized
+    // one unless they are accepted
+    static ProgramPtr load(const char *data, std::size_t size,
+                           const MachineLimits &machine,
+                           bool optimized = true);
+    // The file is memory-mapped
+    static ProgramPtr loadFile(const std::string &path,
+                               const MachineLimits &machine,
+                               bool optimized = true);
+};
+} // namespace computer_internal
+
+#endif // _OBJECT_FILE_H
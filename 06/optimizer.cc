@@ -0,0 +1,251 @@
+#include "optimizer.h"
+
+#include <algorithm>
+
+namespace computer_internal {
+Optimizer::Optimizer() { }
+
+bool Optimizer::Value::operator==(const Value &that) const {
+    if(known != that.known)
+        return false;
+    return known ? constant == that.constant : id == that.id;
+}
+
+bool Optimizer::Value::operator!=(const Value &that) const {
+    return !(*this == that);
+}
+
+Optimizer::State::State() : next_id{0} { }
+
+Optimizer::Value Optimizer::State::unknown() {
+    return {false, 0, next_id++};
+}
+
+Optimizer::Value& Optimizer::State::get(
+        std::unordered_map<code_type, Value> &values, code_type idx) {
+    auto it = values.find(idx);
+    if(it == values.end())
+        it = values.emplace(idx, unknown()).first;
+    return it->second;
+}
+
+Optimizer::Value& Optimizer::State::reg(register_type idx) {
+    return get(registers, idx);
+}
+
+Optimizer::Value& Optimizer::State::cell(memory_type idx) {
+    return get(memory, idx);
+}
+
+std::size_t Optimizer::LocationHash::operator()(const Location &location) const {
+    return std::hash<code_type>{}(location.second) ^ location.first;
+}
+
+template<class Op>
+bool Optimizer::fold(const Value &lhs, const Value &rhs, number_type &result) {
+    if(!lhs.known || !rhs.known)
+        return false;
+
+    // The same conversions as in ArithmeticInstruction
+    result = Op{}(lhs.constant, rhs.constant);
+    return true;
+}
+
+bool Optimizer::propagate(Program &program) {
+    State state;
+    Program result;
+
+    for(const Operation &op : program) {
+        switch(op.opcode) {
+            case Opcode::SET: {
+                Value val{true, op.second, 0};
+                Value &reg = state.reg(op.first);
+                if(reg != val) {
+                    reg = val;
+                    result.push_back(op);
+                }
+                break;
+            }
+            case Opcode::LOAD: {
+                Value val = state.cell(op.second);
+                Value &reg = state.reg(op.first);
+                if(reg == val) // the value is already there
+                    break;
+
+                reg = val;
+                if(val.known)
+                    result.push_back({Opcode::SET, op.first, val.constant});
+                else
+                    result.push_back(op);
+                break;
+            }
+            case Opcode::STORE: {
+                Value val = state.reg(op.second);
+                Value &cell = state.cell(op.first);
+                if(cell != val) {
+                    cell = val;
+                    result.push_back(op);
+                }
+                break;
+            }
+            case Opcode::ADD:
+            case Opcode::SUB:
+            case Opcode::MUL:
+            case Opcode::DIV: {
+                Value rhs = state.reg(op.second);
+                Value &lhs = state.reg(op.first);
+                number_type folded;
+
+                bool known;
+                bool identity; // lhs is left unchanged
+                bool throws = op.opcode == Opcode::DIV
+                    && rhs.known && rhs.constant == 0;
+
+                switch(op.opcode) {
+                    case Opcode::ADD:
+                        known = fold<std::plus<long_number_type>>(lhs, rhs, folded);
+                        identity = rhs.known && rhs.constant == 0;
+                        break;
+                    case Opcode::SUB:
+                        known = fold<std::minus<long_number_type>>(lhs, rhs, folded);
+                        identity = rhs.known && rhs.constant == 0;
+                        break;
+                    case Opcode::MUL:
+                        known = fold<std::multiplies<long_number_type>>(lhs, rhs, folded);
+                        identity = rhs.known && rhs.constant == 1;
+                        break;
+                    default:
+                        known = !throws
+                            && fold<divides<long_number_type>>(lhs, rhs, folded);
+                        identity = rhs.known && rhs.constant == 1;
+                        break;
+                }
+
+                if(throws) {
+                    // Nothing after this instruction is ever executed
+                    result.push_back(op);
+                    program.swap(result);
+                    return false;
+                }
+                else if(known) {
+                    if(!lhs.known || lhs.constant != folded)
+                        result.push_back({Opcode::SET, op.first, folded});
+                    lhs = {true, folded, 0};
+                }
+                else if(!identity) {
+                    lhs = state.unknown();
+                    result.push_back(op);
+                }
+                break;
+            }
+            default:
+                result.push_back(op);
+                break;
+        }
+    }
+
+    program.swap(result);
+    return true;
+}
+
+void Optimizer::eliminateDeadWrites(Program &program) {
+    // The complement of the set of live locations, as everything is live
+    // at the end of the program
+    LocationSet dead;
+    Program result;
+
+    auto reg = [](code_type idx) { return Location{true, idx}; };
+    auto cell = [](code_type idx) { return Location{false, idx}; };
+
+    for(auto it = program.rbegin(); it != program.rend(); ++it) {
+        const Operation &op = *it;
+
+        switch(op.opcode) {
+            case Opcode::SET:
+                if(!dead.insert(reg(op.first)).second)
+                    continue;
+                break;
+            case Opcode::LOAD:
+                if(!dead.insert(reg(op.first)).second)
+                    continue;
+                dead.erase(cell(op.second));
+                break;
+            case Opcode::STORE:
+                if(!dead.insert(cell(op.first)).second)
+                    continue;
+                dead.erase(reg(op.second));
+                break;
+            case Opcode::ADD:
+            case Opcode::SUB:
+            case Opcode::MUL:
+                if(dead.count(reg(op.first)))
+                    continue;
+                dead.erase(reg(op.second));
+                break;
+            case Opcode::DIV:
+                dead.clear();
+                break;
+            default: // PRINTLN
+                dead.erase(reg(op.first));
+                break;
+        }
+
+        result.push_back(op);
+    }
+
+    program.assign(result.rbegin(), result.rend());
+}
+
+void Optimizer::optimizeBlock(const Program &program,
+                              Program::size_type begin,
+                              Program::size_type end,
+                              const MachineLimits &machine,
+                              Program &result) {
+    Program block(program.begin() + begin, program.begin() + end);
+
+    // The first instruction with invalid operands is kept intact, since
+    // everything after it is unreachable and it has to throw. Otherwise the
+    // jump ending the block is kept as it is.
+    auto fault = firstFault(block, machine);
+    if(fault == block.size() && isJump(block.back().opcode))
+        fault = block.size() - 1;
+    Program tail(block.begin() + fault,
+                 block.begin() + std::min(fault + 1, block.size()));
+    block.resize(fault);
+
+    bool reachable = propagate(block);
+    eliminateDeadWrites(block);
+
+    result.insert(result.end(), block.begin(), block.end());
+    if(reachable)
+        result.insert(result.end(), tail.begin(), tail.end());
+}
+
+void Optimizer::optimize(Program &program, const MachineLimits &machine) {
+    // The blocks start at the jump targets and right after the jumps
+    std::vector<bool> leader(program.size() + 1, false);
+    leader[0] = true;
+    leader[program.size()] = true;
+    for(Program::size_type i = 0; i < program.size(); ++i)
+        if(isJump(program[i].opcode)) {
+            leader[jumpTarget(program[i])] = true;
+            leader[i + 1] = true;
+        }
+
+    Program result;
+    // The new position of the first instruction of every block
+    std::vector<Program::size_type> moved(program.size() + 1);
+    Program::size_type end;
+    for(Program::size_type begin = 0; begin < program.size(); begin = end) {
+        for(end = begin + 1; !leader[end]; ++end) { }
+        moved[begin] = result.size();
+        optimizeBlock(program, begin, end, machine, result);
+    }
+    moved[program.size()] = result.size();
+
+    for(Operation &op : result)
+        if(isJump(op.opcode))
+            jumpTarget(op) = static_cast<code_type>(moved[jumpTarget(op)]);
+    program.swap(result);
+}
+} // namespace computer_internal
@@ -0,0 +1,93 @@
+#ifndef _OPTIMIZER_H
+#define _OPTIMIZER_H
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "common.h"
+#include "instruction.h"
+#include "process.h"
+
+namespace computer_internal {
+// Dataflow optimizer for the program images. Every basic block (a sequence
+// of instructions entered only at its start and left only at its end) is
+// optimized on its own, the state of the machine being unknown when it is
+// entered and observable when it is left.
+//
+// The state of the machine is shared between the processes and it survives
+// the end of the process, therefore the optimizer assumes nothing about the
+// initial values of registers and memory cells and treats the final ones as
+// observable. The optimized program prints the same values and throws the
+// same exceptions (at the same point of the output) as the original one as
+// long as no other process runs in the middle of it, hence the OS only
+// optimizes the programs for a single core and a non-preemptive algorithm.
+// The program is shorter though, so SJF may order it differently.
+class Optimizer {
+    private:
+    Optimizer(); // Singleton class
+
+    // A value held by a register or a memory cell: either a known constant
+    // or an unknown one, identified by its number
+    struct Value {
+        bool known;
+        number_type constant;
+        unsigned id;
+
+        bool operator==(const Value &that) const;
+        bool operator!=(const Value &that) const;
+    };
+
+    // Symbolic state of the machine used by the forward pass
+    class State {
+        private:
+        std::unordered_map<register_type, Value> registers;
+        std::unordered_map<memory_type, Value> memory;
+        unsigned next_id;
+
+        Value& get(std::unordered_map<code_type, Value> &values, code_type idx);
+
+        public:
+        State();
+        Value unknown();
+        Value& reg(register_type idx);
+        Value& cell(memory_type idx);
+    };
+
+    // A location written or read by an instruction, used by the liveness
+    // analysis. Registers are positive and memory cells are non-negative,
+    // so they are told apart by the flag.
+    using Location = std::pair<bool, code_type>;
+
+    struct LocationHash {
+        std::size_t operator()(const Location &location) const;
+    };
+
+    using LocationSet = std::unordered_set<Location, LocationHash>;
+
+    // Folds the arithmetic instruction if both operands are known
+    template<class Op>
+    static bool fold(const Value &lhs, const Value &rhs, number_type &result);
+
+    // Constant folding, propagation and forwarding of stored values. The
+    // program is truncated after an instruction which always throws, in
+    // which case false is returned.
+    static bool propagate(Program &program);
+    // Removal of the writes that are overwritten before being read. Every
+    // division is a barrier, since the state at the point it throws is
+    // observable.
+    static void eliminateDeadWrites(Program &program);
+    // Appends the optimized block [begin, end) of the program to the result,
+    // the jump targets are left as they are
+    static void optimizeBlock(const Program &program,
+                              Program::size_type begin,
+                              Program::size_type end,
+                              const MachineLimits &machine,
+                              Program &result);
+
+    public:
+    // The program must not contain superinstructions
+    static void optimize(Program &program, const MachineLimits &machine);
+};
+} // namespace computer_internal
+
+#endif // _OPTIMIZER_H
@@ -1,52 +1,303 @@
 #include "os.h"
 #include <algorithm>
-#include <iterator>
+#include <exception>
+#include <mutex>
+#include <thread>
 #include "assembler.h"
 #include "cpu.h"
+#include "native_code.h"
+#include "object_file.h"
 #include "process.h"
+#include "thread_pool.h"
 
 using namespace computer_internal;
 
-ProcessPtr OS::makeProcess(const std::string &code) {
-    return std::make_shared<Process>(Assembler::compile(code));
+OS::OS(std::vector<std::shared_ptr<CPU>> cpus,
+       RAMPtr ram,
+       std::shared_ptr<SchedulingAlgorithm> scheduler)
+    : cpus{std::move(cpus)}
+    , ram{ram}
+    , scheduler{scheduler}
+    , output{StreamOutput::standard()}
+    , statistics_dump{nullptr}
+    { }
+
+bool OS::sequential() const {
+    return cpus.size() == 1 && !scheduler->preemptive();
+}
+
+void OS::setCompilationOptions(const CompilationOptions &options) {
+    this->options = options;
+    if(!sequential())
+        this->options.optimize = false;
+}
+
+void OS::setProgramCache(std::shared_ptr<ProgramCache> cache) {
+    this->cache = cache;
+}
+
+const ExecutionStatistics& OS::statistics() const {
+    return stats;
+}
+
+void OS::setStatisticsDump(std::ostream *stream) {
+    statistics_dump = stream;
+}
+
+void OS::setCacheModel(std::shared_ptr<const CacheConfiguration> configuration) {
+    if(configuration)
+        configuration->validate();
+    cache_configuration = configuration;
+}
+
+const CacheStatistics& OS::cacheStatistics() const {
+    return cache_stats;
+}
+
+const std::vector<uint64_t>& OS::processCycles() const {
+    return cycles;
 }
 
-OS::OS(std::shared_ptr<CPU> cpu, std::shared_ptr<SchedulingAlgorithm> scheduler)
-    : cpu{cpu}, scheduler{scheduler} { }
+void OS::setOutput(std::shared_ptr<OutputSink> sink) {
+    output = sink;
+}
+
+void OS::setOutput(std::ostream &stream) {
+    output = std::make_shared<StreamOutput>(stream);
+}
 
 void OS::executePrograms(const std::list<std::string> &programs) {
-    using list_type = SchedulingAlgorithm::list_type;
-
-    std::unique_ptr<list_type> list{new list_type{}};
-    std::transform(programs.begin(),
-                   programs.end(),
-                   std::back_inserter<list_type>(*list),
-                   makeProcess);
-    scheduler->setList(std::move(list));
-
-    // The interrupt handler
-    auto schedule = [this]() {
-        auto ret = scheduler->schedule();
-        ProcessPtr process = ret.first;
-        if(!process)
-            cpu->sleep();
+    MachineLimits machine = cpus.front()->limits();
+    const CycleCosts &costs = cpus.front()->cycleCosts();
+    compileAndRun(programs, [this, &machine, &costs](const std::string &code,
+                                                     NativeCodePtr &native) {
+        if(cache)
+            return cache->compile(code, options, machine, &native, costs);
+        return Assembler::compile(code, options, &machine);
+    });
+}
+
+void OS::executeProgramFiles(const std::list<std::string> &paths) {
+    MachineLimits machine = cpus.front()->limits();
+    compileAndRun(paths, [this, &machine](const std::string &path,
+                                          NativeCodePtr&) {
+        return Assembler::compileFile(path, options, &machine);
+    });
+}
+
+void OS::assembleToFile(const std::string &code,
+                        const std::string &path) const {
+    MachineLimits machine = cpus.front()->limits();
+    ProgramPtr program = Assembler::compile(code, options, &machine);
+    ObjectFile::writeFile(*program, options, machine, path);
+}
+
+void OS::executeObjectFiles(const std::list<std::string> &paths) {
+    MachineLimits machine = cpus.front()->limits();
+    bool optimized = sequential();
+    compileAndRun(paths, [&machine, optimized](const std::string &path,
+                                               NativeCodePtr&) {
+        return ObjectFile::loadFile(path, machine, optimized);
+    });
+}
+
+void OS::compileAndRun(const std::list<std::string> &sources,
+        const std::function<ProgramPtr(const std::string&,
+                                       NativeCodePtr&)> &compile) {
+    std::vector<const std::string*> inputs;
+    inputs.reserve(sources.size());
+    for(const auto &source : sources)
+        inputs.push_back(&source);
+
+    // The operands are checked once, so that the valid part of each program
+    // runs without the bounds checks (and may be translated)
+    MachineLimits machine = cpus.front()->limits();
+    const CycleCosts &costs = cpus.front()->cycleCosts();
+    std::vector<ProgramPtr> programs(inputs.size());
+    std::vector<Program::size_type> validated(inputs.size());
+    std::vector<NativeCodePtr> native(inputs.size());
+    bool translate = options.native_code;
+    auto prepare = [&inputs, &programs, &validated, &native, &compile,
+                    &machine, &costs, translate](std::size_t i) {
+        programs[i] = compile(*inputs[i], native[i]);
+        validated[i] = firstFault(*programs[i], machine);
+        if(translate && !native[i])
+            native[i] = NativeCode::translate(*programs[i], validated[i],
+                                              costs);
+    };
+
+    // Every task compiles a contiguous chunk of the programs in order and
+    // stops at the first failure. The pool rethrows the exception of the
+    // first failed task, hence the one of the first failed program.
+    ThreadPool &pool = ThreadPool::shared();
+    std::size_t chunk = std::max<std::size_t>(1,
+        inputs.size() / (CHUNKS_PER_THREAD * (pool.size() + 1)));
+
+    if(inputs.size() <= chunk) {
+        for(std::size_t i = 0; i < inputs.size(); ++i)
+            prepare(i);
+    }
+    else {
+        std::vector<ThreadPool::task_type> tasks;
+        for(std::size_t begin = 0; begin < inputs.size(); begin += chunk) {
+            std::size_t end = std::min(begin + chunk, inputs.size());
+            tasks.push_back([&prepare, begin, end]() {
+                for(std::size_t i = begin; i < end; ++i)
+                    prepare(i);
+            });
+        }
+        pool.run(std::move(tasks));
+    }
+
+    ProcessTable table;
+    table.reserve(programs.size());
+    for(std::size_t i = 0; i < programs.size(); ++i)
+        table.add(programs[i], validated[i], native[i]);
+    run(table);
+}
+
+void OS::run(ProcessTable &table) {
+    scheduler->setProcesses(table);
+
+    // Guards the scheduler and the state below
+    std::mutex lock;
+    // The process executed by each of the cores
+    std::vector<pid_type> jobs(cpus.size(), SchedulingAlgorithm::NO_PROCESS);
+    std::exception_ptr error;
+
+    // The quantum of the current job and the process executed last by each
+    // of the cores, only used (and allocated) by the statistics
+    std::size_t counted = COLLECT_STATISTICS ? cpus.size() : 0;
+    std::vector<time_type> quanta(counted);
+    std::vector<pid_type> last(counted, SchedulingAlgorithm::NO_PROCESS);
+    if(COLLECT_STATISTICS) {
+        stats.clear(table.size());
+        for(auto &cpu : cpus)
+            cpu->clearStatistics();
+    }
+
+    // Every core models its own caches
+    cache_stats.clear();
+    for(auto &cpu : cpus)
+        cpu->setCacheModel(cache_configuration
+            ? std::make_shared<CacheModel>(*cache_configuration, table.size())
+            : nullptr);
+
+    // The interrupt handler of the given core
+    auto schedule = [this, &table, &lock, &jobs, &error, &quanta, &last](
+            std::size_t core) {
+        std::lock_guard<std::mutex> guard{lock};
+        CPU &cpu = *cpus[core];
+
+        if(jobs[core] != SchedulingAlgorithm::NO_PROCESS) {
+            if(COLLECT_STATISTICS) {
+                uint64_t executed = cpu.statistics().slice;
+                stats.processes[jobs[core]] += executed;
+                stats.slices.push_back({jobs[core], core, quanta[core],
+                                        executed});
+            }
+
+            if(!table[jobs[core]].hasNext())
+                output->processFinished(jobs[core]);
+            scheduler->release(jobs[core]);
+            jobs[core] = SchedulingAlgorithm::NO_PROCESS;
+        }
+
+        SchedulingAlgorithm::response_type ret{
+            SchedulingAlgorithm::NO_PROCESS, SchedulingAlgorithm::WITHOUT_TIMER};
+        if(!error)
+            ret = scheduler->schedule();
+
+        pid_type process = ret.first;
+        if(process == SchedulingAlgorithm::NO_PROCESS) {
+            // The table does not outlive the run
+            cpu.setJob(nullptr);
+            cpu.sleep();
+        }
         else {
             time_type quantum = ret.second;
 
             if(quantum != SchedulingAlgorithm::WITHOUT_TIMER)
-                cpu->setTimer(quantum);
+                cpu.setTimer(quantum);
             else
-                cpu->disableTimer();
+                cpu.disableTimer();
+
+            if(COLLECT_STATISTICS) {
+                if(last[core] != SchedulingAlgorithm::NO_PROCESS
+                        && last[core] != process)
+                    ++stats.context_switches;
+                last[core] = process;
+                quanta[core] = quantum;
+            }
 
-            cpu->setJob(process);
+            jobs[core] = process;
+            cpu.setJob(&table[process]);
         }
     };
 
-    cpu->disableTimer();
-    cpu->setInterruptHandler(schedule);
-    schedule();
-    cpu->awaken();
-    // Finished
-    cpu->setInterruptHandler({});
-}
+    // Runs the core until there is nothing left for it to do
+    auto run = [this, &lock, &error, &schedule](std::size_t core) {
+        CPU &cpu = *cpus[core];
+
+        try {
+            cpu.disableTimer();
+            cpu.setOutput(output);
+            cpu.setInterruptHandler([&schedule, core]() { schedule(core); });
+            schedule(core);
+            cpu.awaken();
+        }
+        catch(...) {
+            std::lock_guard<std::mutex> guard{lock};
+            if(!error)
+                error = std::current_exception();
+        }
+
+        // Finished
+        cpu.setInterruptHandler({});
+    };
+
+    std::vector<std::thread> threads;
+    try {
+        for(std::size_t core = 1; core < cpus.size(); ++core)
+            threads.emplace_back(run, core);
+    }
+    catch(...) {
+        // The cores already started will stop at their next interrupt
+        std::lock_guard<std::mutex> guard{lock};
+        error = std::current_exception();
+    }
+
+    run(0);
+    for(auto &thread : threads)
+        thread.join();
 
+    cycles.resize(table.size());
+    for(pid_type process = 0; process < table.size(); ++process)
+        cycles[process] = table[process].elapsed();
+
+    if(COLLECT_STATISTICS) {
+        for(auto &cpu : cpus) {
+            const CoreCounters &counters = cpu->statistics();
+            for(std::size_t i = 0; i < BASE_OPCODES; ++i)
+                stats.opcodes[i] += counters.opcodes[i];
+            stats.timer_interrupts += counters.timer_interrupts;
+        }
+    }
+
+    if(statistics_dump)
+        stats.writeJSON(*statistics_dump);
+
+    for(auto &cpu : cpus) {
+        if(cpu->cacheModel())
+            cache_stats += cpu->cacheModel()->statistics();
+        cpu->setCacheModel(nullptr);
+    }
+
+    // Whatever was printed before an exception has to be written too
+    output->flush();
+    // No core uses the memory anymore
+    ram->compact();
+
+    if(error)
+        std::rethrow_exception(error);
+}
@@ -1,24 +1,101 @@
 #ifndef _OS_H
 #define _OS_H
 
+#include <functional>
+#include <list>
 #include <memory>
+#include <vector>
+#include "assembler.h"
+#include "cache_model.h"
 #include "cpu.h"
 #include "common.h"
+#include "output.h"
+#include "program_cache.h"
 #include "scheduler.h"
+#include "statistics.h"
 #include "forward.h"
 
 class OS {
     private:
-    std::shared_ptr<computer_internal::CPU> cpu;
+    std::vector<std::shared_ptr<computer_internal::CPU>> cpus;
+    computer_internal::RAMPtr ram;
     std::shared_ptr<SchedulingAlgorithm> scheduler;
+    CompilationOptions options;
+    computer_internal::OutputPtr output;
+    std::shared_ptr<ProgramCache> cache;
+    ExecutionStatistics stats;
+    std::ostream *statistics_dump;
+    std::shared_ptr<const CacheConfiguration> cache_configuration;
+    CacheStatistics cache_stats;
+    // Indexed by the process
+    std::vector<uint64_t> cycles;
 
-    static computer_internal::ProcessPtr makeProcess(const std::string &code);
+    // The compilation of a batch is split into this many tasks per thread,
+    // so that the threads are evenly loaded
+    static constexpr std::size_t CHUNKS_PER_THREAD = 4;
 
-    OS(std::shared_ptr<computer_internal::CPU> cpu,
+    // Compiles (or loads) the programs in parallel and runs them. If some of
+    // them fail, the exception of the first one (in the order of the list)
+    // is thrown and none of the programs is run. The compiler may provide
+    // the machine code of the program too, otherwise it is translated if
+    // the options ask for it.
+    void compileAndRun(const std::list<std::string> &sources,
+            const std::function<computer_internal::ProgramPtr(
+                const std::string&, computer_internal::NativeCodePtr&)>
+                &compile);
+    // Runs the processes until all of them finish
+    void run(computer_internal::ProcessTable &table);
+    // Whether every process runs from its start to its end without any other
+    // one touching the registers or the RAM in the meantime
+    bool sequential() const;
+
+    OS(std::vector<std::shared_ptr<computer_internal::CPU>> cpus,
+       computer_internal::RAMPtr ram,
        std::shared_ptr<SchedulingAlgorithm> scheduler);
 
     public:
+    // The optimizer assumes that nothing else touches the registers and the
+    // RAM while a program runs, so it is turned off on a multi-core computer
+    // and with a preemptive scheduling algorithm
+    void setCompilationOptions(const CompilationOptions &options);
+    // The programs passed to executePrograms are looked up in the cache
+    // (which may be shared with other OSes) before being compiled. Null
+    // disables the cache.
+    void setProgramCache(std::shared_ptr<ProgramCache> cache);
+    // The statistics of the last run (see ExecutionStatistics::ENABLED)
+    const ExecutionStatistics& statistics() const;
+    // The statistics are written as JSON to the stream after every run,
+    // null disables it. The stream has to outlive the OS.
+    void setStatisticsDump(std::ostream *stream);
+    // The accesses of LOAD and STORE are run through the modeled cache
+    // hierarchy (which slows the emulation down). Null disables the model.
+    void setCacheModel(std::shared_ptr<const CacheConfiguration> configuration);
+    // The modeled accesses of the last run
+    const CacheStatistics& cacheStatistics() const;
+    // The cycles each process of the last run was executed for (see
+    // CycleCosts), also if some process threw. The time slice a process
+    // threw in is not counted.
+    const std::vector<uint64_t>& processCycles() const;
+    // The values printed by the processes are passed to the sink (by
+    // default they are written to std::cout line by line)
+    void setOutput(std::shared_ptr<OutputSink> sink);
+    // Writes to the stream, which has to outlive the OS
+    void setOutput(std::ostream &stream);
+    // On a multi-core computer the cores are run in parallel, each of them
+    // picking the processes not executed by other cores. If any of the
+    // processes throws, the remaining cores stop at their next interrupt
+    // and the first exception thrown is rethrown.
     void executePrograms(const std::list<std::string> &programs);
+    // Reads the source code of the programs from the files
+    void executeProgramFiles(const std::list<std::string> &paths);
+
+    // Compiles the program for this computer (with the current options) and
+    // writes it to the object file
+    void assembleToFile(const std::string &code, const std::string &path) const;
+    // Runs the precompiled programs loaded from the object files. The
+    // optimized ones are rejected unless the optimizer may be used (see
+    // setCompilationOptions).
+    void executeObjectFiles(const std::list<std::string> &paths);
     friend class Computer;
 };
 
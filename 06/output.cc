@@ -0,0 +1,97 @@
+#include "output.h"
+
+#include <iostream>
+#include <limits>
+
+void OutputSink::processFinished(pid_type) { }
+
+void OutputSink::flush() { }
+
+OutputSink::~OutputSink() { }
+
+StreamOutput::StreamOutput(std::ostream &stream) : stream(stream) { }
+
+void StreamOutput::println(pid_type, number_type value) {
+    std::lock_guard<std::mutex> guard{lock};
+    stream << value << std::endl;
+}
+
+std::shared_ptr<StreamOutput> StreamOutput::standard() {
+    static auto output = std::make_shared<StreamOutput>(std::cout);
+    return output;
+}
+
+constexpr const std::string::size_type BufferedOutput::DEFAULT_CAPACITY;
+
+BufferedOutput::BufferedOutput(std::ostream &stream,
+                               std::string::size_type capacity)
+    : stream(stream), capacity{capacity} {
+    buffer.reserve(capacity + std::numeric_limits<number_type>::digits10 + 3);
+}
+
+void BufferedOutput::write() {
+    stream.write(buffer.data(), buffer.size());
+    buffer.clear();
+}
+
+void BufferedOutput::println(pid_type, number_type value) {
+    // Formatted by hand, as the streams and std::to_string are way too slow
+    char digits[std::numeric_limits<number_type>::digits10 + 3];
+    char *end = digits + sizeof(digits);
+    char *begin = end;
+
+    *--begin = '\n';
+    // Works for the minimal value too, as the digits are computed from the
+    // negative remainders
+    number_type rest = value;
+    do {
+        number_type digit = rest % 10;
+        *--begin = '0' + (digit < 0 ? -digit : digit);
+        rest /= 10;
+    } while(rest != 0);
+
+    if(value < 0)
+        *--begin = '-';
+
+    std::lock_guard<std::mutex> guard{lock};
+    buffer.append(begin, end);
+    if(buffer.size() >= capacity)
+        write();
+}
+
+void BufferedOutput::processFinished(pid_type) {
+    std::lock_guard<std::mutex> guard{lock};
+    write();
+}
+
+void BufferedOutput::flush() {
+    std::lock_guard<std::mutex> guard{lock};
+    write();
+    stream.flush();
+}
+
+void CapturedOutput::println(pid_type process, number_type value) {
+    std::lock_guard<std::mutex> guard{lock};
+    if(values.size() <= process)
+        values.resize(process + 1);
+    values[process].push_back(value);
+}
+
+std::vector<number_type> CapturedOutput::printed(pid_type process) const {
+    std::lock_guard<std::mutex> guard{lock};
+    if(values.size() <= process)
+        return {};
+    return values[process];
+}
+
+void CapturedOutput::clear() {
+    std::lock_guard<std::mutex> guard{lock};
+    values.clear();
+}
+
+CallbackOutput::CallbackOutput(callback_type callback) : callback{callback} { }
+
+void CallbackOutput::println(pid_type process, number_type value) {
+    std::lock_guard<std::mutex> guard{lock};
+    callback(process, value);
+}
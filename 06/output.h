@@ -0,0 +1,91 @@
+#ifndef _OUTPUT_H
+#define _OUTPUT_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "common.h"
+
+// The destination of the values printed by the processes. Processes are
+// identified by their position on the list passed to OS::executePrograms.
+// A sink may be used by many cores at once, so the implementations have to
+// be thread-safe.
+class OutputSink {
+    public:
+    virtual void println(pid_type process, number_type value) = 0;
+    // Called once the process has executed its last instruction
+    virtual void processFinished(pid_type process);
+    // Called at the end of OS::executePrograms (also when it throws)
+    virtual void flush();
+    virtual ~OutputSink();
+};
+
+// Writes (and flushes) every line to the stream immediately
+class StreamOutput : public OutputSink {
+    private:
+    std::ostream &stream;
+    std::mutex lock;
+
+    public:
+    explicit StreamOutput(std::ostream &stream);
+    virtual void println(pid_type process, number_type value) override;
+
+    // The sink shared by everyone printing to std::cout
+    static std::shared_ptr<StreamOutput> standard();
+};
+
+// Collects the lines (in the order they were printed) and writes them to the
+// stream when the buffer fills or some process finishes
+class BufferedOutput : public OutputSink {
+    private:
+    std::ostream &stream;
+    std::string buffer;
+    std::string::size_type capacity;
+    std::mutex lock;
+
+    void write();
+
+    public:
+    constexpr static const std::string::size_type DEFAULT_CAPACITY = 1 << 16;
+
+    explicit BufferedOutput(std::ostream &stream,
+                            std::string::size_type capacity = DEFAULT_CAPACITY);
+    virtual void println(pid_type process, number_type value) override;
+    virtual void processFinished(pid_type process) override;
+    virtual void flush() override;
+};
+
+// Keeps the values printed by every process separately in memory
+class CapturedOutput : public OutputSink {
+    private:
+    std::vector<std::vector<number_type>> values;
+    mutable std::mutex lock;
+
+    public:
+    virtual void println(pid_type process, number_type value) override;
+    std::vector<number_type> printed(pid_type process) const;
+    void clear();
+};
+
+// Passes every value to the callback, one call at a time
+class CallbackOutput : public OutputSink {
+    public:
+    using callback_type = std::function<void(pid_type, number_type)>;
+
+    private:
+    callback_type callback;
+    std::mutex lock;
+
+    public:
+    explicit CallbackOutput(callback_type callback);
+    virtual void println(pid_type process, number_type value) override;
+};
+
+namespace computer_internal {
+using OutputPtr = std::shared_ptr<OutputSink>;
+} // namespace computer_internal
+
+#endif // _OUTPUT_H
@@ -1,18 +1,85 @@
 #include "process.h"
 
 namespace computer_internal {
-Process::Process(const ProgramPtr &text)
-    : text{text}, instruction_pointer{this->text->cbegin()} { }
+Program::size_type firstFault(const Program &program,
+                              const MachineLimits &machine) {
+    for(Program::size_type i = 0; i < program.size(); ++i)
+        if(!validOperands(program[i], machine))
+            return i;
 
-bool Process::hasNext() {
-    return instruction_pointer != text->cend();
+    return program.size();
 }
 
-const ProgramPtr& Process::program() {
-    return text;
+Process::Process(const Program &text, pid_type id,
+                 Program::size_type validated,
+                 const NativeCode *native)
+    : text{&text}
+    , pid{id}
+    , instruction_pointer{0}
+    , valid_prefix{validated}
+    , native_code{native}
+    , time{0} { }
+
+pid_type Process::id() const {
+    return pid;
+}
+
+bool Process::hasNext() const {
+    return instruction_pointer != text->size();
+}
+
+const Program& Process::program() const {
+    return *text;
+}
+
+Program::size_type Process::position() const {
+    return instruction_pointer;
+}
+
+void Process::seek(Program::size_type position) {
+    instruction_pointer = position;
+}
+
+Program::size_type Process::validated() const {
+    return valid_prefix;
+}
+
+const NativeCode* Process::native() const {
+    return native_code;
+}
+
+uint64_t Process::elapsed() const {
+    return time;
+}
+
+void Process::account(uint64_t time) {
+    this->time += time;
+}
+
+void ProcessTable::reserve(std::size_t processes) {
+    this->processes.reserve(processes);
+}
+
+pid_type ProcessTable::add(const ProgramPtr &program,
+                           Program::size_type validated,
+                           const NativeCodePtr &native) {
+    programs.insert(program);
+    if(native)
+        native_code.insert(native);
+    processes.emplace_back(*program, processes.size(), validated,
+                           native.get());
+    return processes.size() - 1;
+}
+
+std::size_t ProcessTable::size() const {
+    return processes.size();
+}
+
+Process& ProcessTable::operator[](pid_type process) {
+    return processes[process];
 }
 
-std::shared_ptr<const Instruction> Process::next() {
-    return *(instruction_pointer++);
+const Process& ProcessTable::operator[](pid_type process) const {
+    return processes[process];
 }
 } // namespace computer_internal
@@ -1,31 +1,79 @@
 #ifndef _PROCESS_H
 #define _PROCESS_H
 
-#include <list>
 #include <memory>
+#include <unordered_set>
+#include <vector>
 #include "common.h"
 #include "instruction.h"
 
 namespace computer_internal {
-using Program = std::list<std::shared_ptr<const Instruction>>;
+// The program image is stored contiguously, one Operation per instruction
+using Program = std::vector<Operation>;
 using ProgramPtr = std::shared_ptr<Program>;
 
+// Forward declaration
+class NativeCode;
+using NativeCodePtr = std::shared_ptr<const NativeCode>;
+
+// Index of the first instruction which accesses a register or a memory cell
+// the machine does not have (or the size of the program)
+Program::size_type firstFault(const Program &program,
+                              const MachineLimits &machine);
+
+// A process descriptor. The descriptors are stored by value in the
+// ProcessTable, which also keeps their programs alive.
 class Process {
-    public:
     private:
-    ProgramPtr text;
-    Program::const_iterator instruction_pointer;
+    const Program *text;
+    pid_type pid;
+    Program::size_type instruction_pointer;
+    // The instructions before this one have valid operands
+    Program::size_type valid_prefix;
+    // Null if the program has not been translated
+    const NativeCode *native_code;
+    // The emulated time the process has been executed for, in cycles
+    uint64_t time;
 
     public:
-    explicit Process(const ProgramPtr &text);
-    const ProgramPtr& program();
+    Process(const Program &text, pid_type id,
+            Program::size_type validated = 0,
+            const NativeCode *native = nullptr);
+    pid_type id() const;
+    const Program& program() const;
 
-    bool hasNext();
-    // Picks the next instruction and increments the instruction pointer
-    std::shared_ptr<const Instruction> next();
+    bool hasNext() const;
+    // The index of the next instruction to be executed
+    Program::size_type position() const;
+    void seek(Program::size_type position);
+    // The number of leading instructions which may be executed without the
+    // bounds checks
+    Program::size_type validated() const;
+    // The machine code of the leading part of the program (or null)
+    const NativeCode* native() const;
+
+    uint64_t elapsed() const;
+    void account(uint64_t time);
 };
 
-using ProcessPtr = std::shared_ptr<Process>;
+// The processes of a single run stored contiguously and identified by their
+// index, which is also their id
+class ProcessTable {
+    private:
+    std::vector<Process> processes;
+    // The programs of the processes and their machine code, each one once
+    std::unordered_set<ProgramPtr> programs;
+    std::unordered_set<NativeCodePtr> native_code;
+
+    public:
+    void reserve(std::size_t processes);
+    pid_type add(const ProgramPtr &program, Program::size_type validated,
+                 const NativeCodePtr &native = nullptr);
+    std::size_t size() const;
+
+    Process& operator[](pid_type process);
+    const Process& operator[](pid_type process) const;
+};
 } // namespace computer_internal
 
 #endif // _PROCESS_H
@@ -0,0 +1,134 @@
+#include "program_cache.h"
+
+using namespace computer_internal;
+
+constexpr const std::size_t ProgramCache::DEFAULT_CAPACITY;
+
+ProgramCache::ProgramCache(std::size_t capacity)
+    : capacity{capacity}, stats{0, 0, 0, 0, 0} { }
+
+uint64_t ProgramCache::hash(const std::string &code,
+                            const CompilationOptions &options,
+                            const MachineLimits &machine,
+                            const CycleCosts &costs) {
+    // FNV-1a
+    const uint64_t prime = 1099511628211ull;
+    uint64_t result = 14695981039346656037ull;
+    auto mix = [&result, prime](uint64_t value) {
+        result = (result ^ value) * prime;
+    };
+
+    for(char c : code)
+        mix(static_cast<unsigned char>(c));
+    mix(options.fuse_instructions);
+    mix(options.optimize);
+    mix(options.native_code);
+    if(options.optimize || options.native_code) {
+        mix(static_cast<uint32_t>(machine.registers));
+        mix(static_cast<uint32_t>(machine.memory));
+    }
+    if(options.native_code)
+        for(std::size_t i = 0; i < BASE_OPCODES; ++i)
+            mix(costs.get(static_cast<Opcode>(i)));
+    return result;
+}
+
+bool ProgramCache::matches(const Entry &entry,
+                           const std::string &code,
+                           const CompilationOptions &options,
+                           const MachineLimits &machine,
+                           const CycleCosts &costs) {
+    if(entry.fuse_instructions != options.fuse_instructions
+            || entry.optimize != options.optimize
+            || entry.native_code != options.native_code)
+        return false;
+
+    if((options.optimize || options.native_code)
+            && (entry.machine.registers != machine.registers
+                || entry.machine.memory != machine.memory))
+        return false;
+
+    if(options.native_code && entry.costs != costs)
+        return false;
+
+    // The hashes of different sources may collide
+    return entry.source == code;
+}
+
+void ProgramCache::shrink(std::size_t size) {
+    while(stats.bytes > size) {
+        const Entry &victim = entries.back();
+        stats.bytes -= victim.bytes;
+        index.erase(victim.key);
+        entries.pop_back();
+        ++stats.evictions;
+    }
+    stats.entries = entries.size();
+}
+
+ProgramPtr ProgramCache::compile(const std::string &code,
+                                 const CompilationOptions &options,
+                                 const MachineLimits &machine,
+                                 NativeCodePtr *native,
+                                 const CycleCosts &costs) {
+    uint64_t key = hash(code, options, machine, costs);
+
+    {
+        std::lock_guard<std::mutex> guard{lock};
+        auto it = index.find(key);
+        if(it != index.end() && matches(*it->second, code, options, machine, costs)) {
+            entries.splice(entries.begin(), entries, it->second);
+            ++stats.hits;
+            if(native)
+                *native = it->second->native;
+            return it->second->program;
+        }
+        ++stats.misses;
+    }
+
+    ProgramPtr program = Assembler::compile(code, options, &machine);
+    NativeCodePtr translated;
+    if(options.native_code)
+        translated = NativeCode::translate(*program,
+                                           firstFault(*program, machine),
+                                           costs);
+    if(native)
+        *native = translated;
+
+    std::size_t bytes = sizeof(Entry) + code.size()
+        + program->capacity() * sizeof(Operation)
+        + (translated ? translated->bytes() : 0);
+    if(bytes > capacity)
+        return program;
+
+    std::lock_guard<std::mutex> guard{lock};
+    // Replaces the program compiled in the meantime or the colliding one
+    auto it = index.find(key);
+    if(it != index.end()) {
+        stats.bytes -= it->second->bytes;
+        entries.erase(it->second);
+        index.erase(it);
+    }
+
+    shrink(capacity - bytes);
+    entries.push_front(Entry{key, code, options.fuse_instructions,
+                             options.optimize, options.native_code, machine,
+                             costs, program, translated, bytes});
+    index.emplace(key, entries.begin());
+    stats.bytes += bytes;
+    stats.entries = entries.size();
+    return program;
+}
+
+ProgramCache::Statistics ProgramCache::statistics() const {
+    std::lock_guard<std::mutex> guard{lock};
+    return stats;
+}
+
+void ProgramCache::clear() {
+    std::lock_guard<std::mutex> guard{lock};
+    entries.clear();
+    index.clear();
+    stats.entries = 0;
+    stats.bytes = 0;
+}
@@ -0,0 +1,92 @@
+#ifndef _PROGRAM_CACHE_H
+#define _PROGRAM_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "assembler.h"
+#include "common.h"
+#include "cycle_costs.h"
+#include "native_code.h"
+#include "process.h"
+
+// A cache of compiled programs keyed by their source code, which may be
+// shared by many computers (and OSes) used at once. The compiled images are
+// immutable, so the processes share them with the cache. The least recently
+// used programs are evicted once the total size exceeds the capacity.
+class ProgramCache {
+    public:
+    struct Statistics {
+        std::size_t hits;
+        std::size_t misses;
+        std::size_t evictions;
+        std::size_t entries;
+        // The estimated memory taken by the sources, the images and the
+        // machine code
+        std::size_t bytes;
+    };
+
+    constexpr static const std::size_t DEFAULT_CAPACITY = 64 << 20;
+
+    private:
+    // Everything the compiled image depends on. The machine is only used by
+    // the optimizer and the translation, and the costs by the translation,
+    // so they are not a part of the key otherwise.
+    struct Entry {
+        uint64_t key;
+        std::string source;
+        bool fuse_instructions;
+        bool optimize;
+        bool native_code;
+        computer_internal::MachineLimits machine;
+        CycleCosts costs;
+
+        computer_internal::ProgramPtr program;
+        computer_internal::NativeCodePtr native;
+        std::size_t bytes;
+    };
+
+    using lru_type = std::list<Entry>;
+
+    std::size_t capacity;
+    // The most recently used entry is at the front
+    lru_type entries;
+    std::unordered_map<uint64_t, lru_type::iterator> index;
+    Statistics stats;
+    mutable std::mutex lock;
+
+    static uint64_t hash(const std::string &code,
+                         const CompilationOptions &options,
+                         const computer_internal::MachineLimits &machine,
+                         const CycleCosts &costs);
+    static bool matches(const Entry &entry,
+                        const std::string &code,
+                        const CompilationOptions &options,
+                        const computer_internal::MachineLimits &machine,
+                        const CycleCosts &costs);
+    // Evicts the least recently used entries until the size fits
+    void shrink(std::size_t size);
+
+    public:
+    // The capacity is given in bytes
+    explicit ProgramCache(std::size_t capacity = DEFAULT_CAPACITY);
+    ProgramCache(const ProgramCache&) = delete;
+    ProgramCache& operator=(const ProgramCache&) = delete;
+
+    // Returns the cached image or compiles the program (without holding the
+    // lock, so that many programs may be compiled at once). If the options
+    // ask for the machine code, it is cached and returned too.
+    computer_internal::ProgramPtr compile(const std::string &code,
+            const CompilationOptions &options,
+            const computer_internal::MachineLimits &machine,
+            computer_internal::NativeCodePtr *native = nullptr,
+            const CycleCosts &costs = CycleCosts{});
+
+    Statistics statistics() const;
+    void clear();
+};
+
+#endif // _PROGRAM_CACHE_H
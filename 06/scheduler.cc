@@ -1,85 +1,298 @@
 #include "scheduler.h"
 
+#include <limits>
+
 namespace computer_internal {
-void Scheduler::listChanged() { }
+Scheduler::Scheduler() : unfinished{0}, clock{0}, table{nullptr} { }
+
+time_type Scheduler::quantum(pid_type) {
+    return SchedulingAlgorithm::WITHOUT_TIMER;
+}
+
+void Scheduler::executed(pid_type, uint64_t) { }
+
+void Scheduler::preempted(pid_type) { }
 
-void Scheduler::setList(std::unique_ptr<list_type> processes) {
-    active = std::move(processes);
-    listChanged();
+std::size_t Scheduler::remaining() const {
+    return unfinished;
+}
+
+void Scheduler::setProcesses(const ProcessTable &table) {
+    this->table = &table;
+    reset(table.size());
+    unfinished = 0;
+    clock = 0;
+    timings.assign(table.size(), Timing{0, 0, 0, false});
+    latencies.clear();
 
-    // Current should point to the last process, it will be incremented
-    // when schedule will be called
-    current = active->end();
-    if(current != active->begin())
-        --current;
+    for(pid_type process = 0; process < table.size(); ++process) {
+        if(!table[process].hasNext())
+            continue;
+        ++unfinished;
+        ready(process);
+    }
 }
 
-std::pair<ProcessPtr, time_type> Scheduler::schedule() {
-    // Indicates whether a process was deleted from the active processes list
-    // (and therefore the current-process-iterator should not be incremented)
-    bool deleted = false;
+std::pair<pid_type, time_type> Scheduler::schedule() {
+    // None if everything has finished or the remaining processes are
+    // executed by other cores
+    pid_type process = next();
+    if(process == SchedulingAlgorithm::NO_PROCESS)
+        return {process, SchedulingAlgorithm::WITHOUT_TIMER};
 
-    while(current != active->end() && !(*current)->hasNext()) {
-        current = active->erase(current);
-        deleted = true;
+    Timing &timing = timings[process];
+    timing.waited += clock - timing.queued;
+    timing.dispatched = (*table)[process].elapsed();
+    if(!timing.started) {
+        timing.started = true;
+        latencies.response.record(clock);
     }
 
-    if(!deleted && current != active->end())
-        ++current;
+    return {process, quantum(process)};
+}
 
-    if(current == active->end())
-        current = active->begin();
+void Scheduler::release(pid_type process) {
+    const Process &descriptor = (*table)[process];
+    Timing &timing = timings[process];
+    uint64_t time = descriptor.elapsed() - timing.dispatched;
+    clock += time;
+    executed(process, time);
 
-    if(active->empty()) // finished! :)
-        return {{}, SchedulingAlgorithm::WITHOUT_TIMER};
-    else
-        return pickProcess();
+    if(!descriptor.hasNext()) {
+        --unfinished;
+        latencies.wait.record(timing.waited);
+        latencies.turnaround.record(clock);
+        return;
+    }
+
+    timing.queued = clock;
+    preempted(process);
+    ready(process);
+}
+
+const SchedulerTelemetry& Scheduler::telemetry() const {
+    return latencies;
+}
+
+bool Scheduler::preemptive() const {
+    return true;
 }
 
 Scheduler::~Scheduler() { }
 
-std::pair<ProcessPtr, time_type> FCFSScheduler::pickProcess() {
-    return {*current, SchedulingAlgorithm::WITHOUT_TIMER};
+void FCFSScheduler::reset(std::size_t) {
+    queue.clear();
+}
+
+void FCFSScheduler::ready(pid_type process) {
+    queue.push_back(process);
+}
+
+pid_type FCFSScheduler::next() {
+    if(queue.empty())
+        return SchedulingAlgorithm::NO_PROCESS;
+
+    pid_type process = queue.front();
+    queue.pop_front();
+    return process;
+}
+
+bool FCFSScheduler::preemptive() const {
+    return false;
+}
+
+RRScheduler::RRScheduler(time_type quantum) : slice{quantum} { }
+
+time_type RRScheduler::quantum(pid_type) {
+    return slice;
+}
+
+bool RRScheduler::preemptive() const {
+    return slice != SchedulingAlgorithm::WITHOUT_TIMER;
+}
+
+constexpr uint64_t SJFScheduler::ASSUMED_ITERATIONS;
+constexpr unsigned SJFScheduler::MAX_NESTING;
+
+uint64_t SJFScheduler::estimate(const Program &program) {
+    // The number of loops each instruction is inside of, as the differences
+    // between the consecutive instructions
+    std::vector<int> nesting;
+    for(Program::size_type i = 0; i < program.size(); ++i) {
+        if(!isJump(program[i].opcode))
+            continue;
+        auto target = static_cast<Program::size_type>(jumpTarget(program[i]));
+        if(target > i)
+            continue;
+
+        if(nesting.empty())
+            nesting.resize(program.size() + 1);
+        ++nesting[target];
+        --nesting[i + 1];
+    }
+
+    if(nesting.empty())
+        return program.size();
+
+    uint64_t weight[MAX_NESTING + 1] = {1};
+    for(unsigned depth = 1; depth <= MAX_NESTING; ++depth)
+        weight[depth] = weight[depth - 1] * ASSUMED_ITERATIONS;
+
+    uint64_t length = 0;
+    int depth = 0;
+    for(Program::size_type i = 0; i < program.size(); ++i) {
+        depth += nesting[i];
+        length += weight[std::min<unsigned>(depth, MAX_NESTING)];
+    }
+    return length;
+}
+
+void SJFScheduler::reset(std::size_t) {
+    heap.clear();
+}
+
+void SJFScheduler::ready(pid_type process) {
+    heap.push({estimate((*table)[process].program()), process}, process);
+}
+
+pid_type SJFScheduler::next() {
+    return heap.empty() ? SchedulingAlgorithm::NO_PROCESS : heap.pop();
+}
+
+bool SJFScheduler::preemptive() const {
+    return false;
+}
+
+MLFQScheduler::MLFQScheduler(time_type quantum, unsigned levels,
+                             time_type boost_period)
+    : base_quantum{quantum}
+    , boost_period{boost_period}
+    , since_boost{0}
+    , levels(levels) {
+    if(quantum <= 0 || levels == 0 || boost_period < 0)
+        throw IllegalArgumentException();
+    // The quantum of the bottom level has to fit
+    if(levels > std::numeric_limits<time_type>::digits
+            || quantum > std::numeric_limits<time_type>::max()
+                         >> (levels - 1))
+        throw IllegalArgumentException("Too many levels");
+}
+
+void MLFQScheduler::boost() {
+    ReadyQueue &top = levels.front();
+    for(auto it = levels.begin() + 1; it != levels.end(); ++it) {
+        top.insert(top.end(), std::make_move_iterator(it->begin()),
+                   std::make_move_iterator(it->end()));
+        it->clear();
+    }
+
+    std::fill(level.begin(), level.end(), 0);
+    since_boost = 0;
+}
+
+void MLFQScheduler::reset(std::size_t processes) {
+    for(auto &queue : levels)
+        queue.clear();
+    level.assign(processes, 0);
+    since_boost = 0;
+}
+
+void MLFQScheduler::ready(pid_type process) {
+    levels[level[process]].push_back(process);
+}
+
+pid_type MLFQScheduler::next() {
+    // The time executed since the last boost is at least the period, so
+    // the cost of the boost is amortized
+    if(boost_period > 0 && since_boost >= boost_period)
+        boost();
+
+    for(auto &queue : levels) {
+        if(queue.empty())
+            continue;
+
+        pid_type process = queue.front();
+        queue.pop_front();
+        return process;
+    }
+
+    return SchedulingAlgorithm::NO_PROCESS;
+}
+
+time_type MLFQScheduler::quantum(pid_type process) {
+    return base_quantum << level[process];
+}
+
+void MLFQScheduler::executed(pid_type, uint64_t time) {
+    if(since_boost < boost_period)
+        since_boost += static_cast<time_type>(std::min<uint64_t>(
+            time, static_cast<uint64_t>(boost_period - since_boost)));
 }
 
-RRScheduler::RRScheduler(time_type quantum) : quantum{quantum} { }
+void MLFQScheduler::preempted(pid_type process) {
+    unsigned &current = level[process];
+    if(current + 1 < levels.size())
+        ++current;
+}
 
-std::pair<ProcessPtr, time_type> RRScheduler::pickProcess() {
-    return {*current, quantum};
+CFSScheduler::CFSScheduler(time_type latency, time_type granularity)
+    : latency{latency}, granularity{granularity} {
+    if(latency <= 0 || granularity <= 0)
+        throw IllegalArgumentException();
 }
 
-auto SJFScheduler::length(const ProcessPtr &p) -> decltype(p->program()->size()) {
-    return p->program()->size();
+void CFSScheduler::reset(std::size_t processes) {
+    heap.clear();
+    vruntime.assign(processes, 0);
+    slice.assign(processes, 0);
 }
 
-bool SJFScheduler::compare(const ProcessPtr &lhs, const ProcessPtr &rhs) {
-    return length(lhs) < length(rhs);
+void CFSScheduler::ready(pid_type process) {
+    heap.push({vruntime[process], process}, process);
 }
 
-void SJFScheduler::listChanged() {
-    active->sort(compare);
+pid_type CFSScheduler::next() {
+    return heap.empty() ? SchedulingAlgorithm::NO_PROCESS : heap.pop();
 }
 
-std::pair<ProcessPtr, time_type> SJFScheduler::pickProcess() {
-    return {*current, SchedulingAlgorithm::WITHOUT_TIMER};
+time_type CFSScheduler::quantum(pid_type process) {
+    time_type share = static_cast<time_type>(
+        latency / std::max<std::size_t>(1, remaining()));
+    return slice[process] = std::max(share, granularity);
 }
 
+void CFSScheduler::preempted(pid_type process) {
+    vruntime[process] += slice[process];
+}
 } // namespace computer_internal
 
 using namespace computer_internal;
 constexpr const time_type SchedulingAlgorithm::WITHOUT_TIMER;
+constexpr const pid_type SchedulingAlgorithm::NO_PROCESS;
 
 SchedulingAlgorithm::SchedulingAlgorithm(std::shared_ptr<Scheduler> implementation)
     : implementation{implementation} { }
 
-void SchedulingAlgorithm::setList(std::unique_ptr<list_type> processes) const {
-    implementation->setList(std::move(processes));
+void SchedulingAlgorithm::setProcesses(const ProcessTable &table) const {
+    implementation->setProcesses(table);
 }
 
-std::pair<ProcessPtr, time_type> SchedulingAlgorithm::schedule() const {
+std::pair<pid_type, time_type> SchedulingAlgorithm::schedule() const {
     return implementation->schedule();
 }
 
+void SchedulingAlgorithm::release(pid_type process) const {
+    implementation->release(process);
+}
+
+const SchedulerTelemetry& SchedulingAlgorithm::telemetry() const {
+    return implementation->telemetry();
+}
+
+bool SchedulingAlgorithm::preemptive() const {
+    return implementation->preemptive();
+}
+
 std::shared_ptr<SchedulingAlgorithm> createFCFSScheduling() {
     auto scheduler = std::make_shared<FCFSScheduler>();
     return std::make_shared<SchedulingAlgorithm>(scheduler);
@@ -94,3 +307,16 @@ std::shared_ptr<SchedulingAlgorithm> createSJFScheduling() {
     auto scheduler = std::make_shared<SJFScheduler>();
     return std::make_shared<SchedulingAlgorithm>(scheduler);
 }
+
+std::shared_ptr<SchedulingAlgorithm> createMLFQScheduling(time_type quantum,
+        unsigned levels, time_type boost_period) {
+    auto scheduler = std::make_shared<MLFQScheduler>(quantum, levels,
+                                                     boost_period);
+    return std::make_shared<SchedulingAlgorithm>(scheduler);
+}
+
+std::shared_ptr<SchedulingAlgorithm> createCFSScheduling(time_type latency,
+        time_type granularity) {
+    auto scheduler = std::make_shared<CFSScheduler>(latency, granularity);
+    return std::make_shared<SchedulingAlgorithm>(scheduler);
+}
@@ -1,11 +1,16 @@
 #ifndef _SCHEDULER_H
 #define _SCHEDULER_H
 
-#include <list>
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <utility>
+#include <vector>
 #include "common.h"
 #include "process.h"
+#include "telemetry.h"
 
 namespace computer_internal {
 // Forward declaration
@@ -20,74 +25,237 @@ class SchedulingAlgorithm {
 
     public:
     constexpr static const time_type WITHOUT_TIMER = 0;
+    constexpr static const pid_type NO_PROCESS =
+        std::numeric_limits<pid_type>::max();
 
     // <which process should run next, the quantum allocated>
-    // null shared pointer is passed as the process pointer when
-    // the CPU should be halted. Quantum may be equal to WITHOUT_TIMER
-    using response_type = std::pair<computer_internal::ProcessPtr, time_type>;
-    using list_type = std::list<computer_internal::ProcessPtr>;
+    // NO_PROCESS is passed as the process when the CPU should be halted.
+    // Quantum may be equal to WITHOUT_TIMER, it is given in cycles (every
+    // instruction takes one unless the computer is given other CycleCosts)
+    using response_type = std::pair<pid_type, time_type>;
 
     SchedulingAlgorithm(std::shared_ptr<computer_internal::Scheduler> implementation);
-    void setList(std::unique_ptr<list_type> processes) const;
+    // The table has to outlive the run
+    void setProcesses(const computer_internal::ProcessTable &table) const;
+    // The picked process is removed from the scheduler until it is released
     response_type schedule() const;
+    // Gives back the process which was preempted (or has finished)
+    void release(pid_type process) const;
+    // The latencies of the processes of the last run
+    const SchedulerTelemetry& telemetry() const;
+    // Whether a process may be interrupted by another one before it finishes
+    bool preemptive() const;
 };
 
 
 namespace computer_internal {
-// The real scheduler
+// The processes ready to run in the order they were queued
+using ReadyQueue = std::deque<pid_type>;
+
+// The ready processes ordered by the key, the least one first
+template<class Key>
+class ReadyHeap {
+    private:
+    using entry_type = std::pair<Key, pid_type>;
+
+    std::vector<entry_type> heap;
+
+    static bool later(const entry_type &lhs, const entry_type &rhs) {
+        return rhs.first < lhs.first;
+    }
+
+    public:
+    bool empty() const {
+        return heap.empty();
+    }
+
+    void clear() {
+        heap.clear();
+    }
+
+    void push(const Key &key, pid_type process) {
+        heap.emplace_back(key, process);
+        std::push_heap(heap.begin(), heap.end(), later);
+    }
+
+    pid_type pop() {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        pid_type process = heap.back().second;
+        heap.pop_back();
+        return process;
+    }
+};
+
+// The real scheduler. Only the ready processes are kept by the deriving
+// classes: the running ones are handed out by schedule() and come back
+// through release(), the finished ones are dropped then.
 class Scheduler {
     public:
-    using list_type = SchedulingAlgorithm::list_type;
     using response_type = SchedulingAlgorithm::response_type;
 
+    private:
+    // The processes which have not finished yet (including the running ones)
+    std::size_t unfinished;
+
+    struct Timing {
+        // The clock when the process was queued last
+        uint64_t queued;
+        // The total time spent in the queue
+        uint64_t waited;
+        // The time of the process when it was picked last
+        uint64_t dispatched;
+        bool started;
+    };
+
+    // The emulated time, advanced by every slice released
+    uint64_t clock;
+    // Indexed by the process
+    std::vector<Timing> timings;
+    SchedulerTelemetry latencies;
+
     protected:
-    std::unique_ptr<list_type> active;
-    list_type::iterator current;
+    const ProcessTable *table;
 
-    // Deriving classes may want to perform some action when the list is
-    // changed (e.g. sort it according to some fancy predicate)
-    virtual void listChanged();
+    // Called before the processes of a new table are queued
+    virtual void reset(std::size_t processes) = 0;
+    // Queues the ready process
+    virtual void ready(pid_type process) = 0;
+    // Dequeues the process which should run next, NO_PROCESS if there is
+    // none
+    virtual pid_type next() = 0;
+    // How long should the process run
+    virtual time_type quantum(pid_type process);
+    // Called with the time the process was executed for whenever it is
+    // released, before it is queued again or dropped
+    virtual void executed(pid_type process, uint64_t time);
+    // Called when the process used up its quantum, before it is queued again
+    virtual void preempted(pid_type process);
 
-    // The function which picks the process (deriving classes SHOULD pick
-    // *current, but they are not required to (as in RFC2119)) and decides
-    // how long should it run.
-    virtual response_type pickProcess() = 0;
+    std::size_t remaining() const;
 
     public:
-    void setList(std::unique_ptr<list_type> processes);
+    Scheduler();
+    void setProcesses(const ProcessTable &table);
     response_type schedule();
+    void release(pid_type process);
+    const SchedulerTelemetry& telemetry() const;
+    // True unless the algorithm never sets the timer
+    virtual bool preemptive() const;
     virtual ~Scheduler();
 };
 
 class FCFSScheduler : public Scheduler {
+    private:
+    ReadyQueue queue;
+
+    protected:
+    virtual void reset(std::size_t processes) override;
+    virtual void ready(pid_type process) override;
+    virtual pid_type next() override;
+
     public:
-    virtual response_type pickProcess() override;
+    virtual bool preemptive() const override;
 };
 
-class RRScheduler : public Scheduler {
+class RRScheduler : public FCFSScheduler {
     private:
-    time_type quantum;
+    time_type slice;
+
+    protected:
+    virtual time_type quantum(pid_type process) override;
 
     public:
     RRScheduler(time_type quantum);
-    virtual response_type pickProcess() override;
+    virtual bool preemptive() const override;
 };
 
+// The shortest job first, the jobs of the same estimated length in the order
+// of the list. The length of a program without loops is its upper bound,
+// the body of every loop (a jump backwards) is assumed to be executed
+// ASSUMED_ITERATIONS times.
 class SJFScheduler : public Scheduler {
     private:
-    // Auxiliary functions used to sort the list of processes
-    static auto length(const ProcessPtr &p) -> decltype(p->program()->size());
-    static bool compare(const ProcessPtr &lhs, const ProcessPtr &rhs);
+    using key_type = std::pair<uint64_t, pid_type>;
+
+    static constexpr uint64_t ASSUMED_ITERATIONS = 16;
+    // Deeper loops are not weighted any more
+    static constexpr unsigned MAX_NESTING = 8;
+
+    ReadyHeap<key_type> heap;
+
+    static uint64_t estimate(const Program &program);
+
+    protected:
+    virtual void reset(std::size_t processes) override;
+    virtual void ready(pid_type process) override;
+    virtual pid_type next() override;
+
+    public:
+    virtual bool preemptive() const override;
+};
+
+// Multi-level feedback queue. The processes start at the top level and are
+// moved one level down whenever they use up their quantum, which doubles
+// with every level. Every boost_period units of the time the processes were
+// executed for all of them are moved back to the top.
+class MLFQScheduler : public Scheduler {
+    private:
+    time_type base_quantum;
+    time_type boost_period;
+    time_type since_boost;
+    // The ready processes of each level, the top one first
+    std::vector<ReadyQueue> levels;
+    // The level of each process
+    std::vector<unsigned> level;
+
+    void boost();
+
+    protected:
+    virtual void reset(std::size_t processes) override;
+    virtual void ready(pid_type process) override;
+    virtual pid_type next() override;
+    virtual time_type quantum(pid_type process) override;
+    virtual void executed(pid_type process, uint64_t time) override;
+    virtual void preempted(pid_type process) override;
+
+    public:
+    MLFQScheduler(time_type quantum, unsigned levels, time_type boost_period);
+};
+
+// Fair scheduler which picks the process with the least virtual runtime
+// (the time it has been given so far). The target latency is split evenly
+// between the unfinished processes, but no slice is shorter than the
+// granularity.
+class CFSScheduler : public Scheduler {
+    private:
+    using key_type = std::pair<long_number_type, pid_type>;
+
+    time_type latency;
+    time_type granularity;
+    ReadyHeap<key_type> heap;
+    std::vector<long_number_type> vruntime;
+    // The slice handed out to each process
+    std::vector<time_type> slice;
 
     protected:
-    virtual void listChanged() override;
-    
+    virtual void reset(std::size_t processes) override;
+    virtual void ready(pid_type process) override;
+    virtual pid_type next() override;
+    virtual time_type quantum(pid_type process) override;
+    virtual void preempted(pid_type process) override;
+
     public:
-    virtual response_type pickProcess() override;
+    CFSScheduler(time_type latency, time_type granularity);
 };
 } // namespace computer_internal
 
 std::shared_ptr<SchedulingAlgorithm> createFCFSScheduling();
 std::shared_ptr<SchedulingAlgorithm> createRRScheduling(time_type quantum);
 std::shared_ptr<SchedulingAlgorithm> createSJFScheduling();
+// The quantum of the top level has to be positive
+std::shared_ptr<SchedulingAlgorithm> createMLFQScheduling(time_type quantum,
+        unsigned levels = 3, time_type boost_period = 0);
+// Both the latency and the granularity have to be positive
+std::shared_ptr<SchedulingAlgorithm> createCFSScheduling(time_type latency = 48,
+        time_type granularity = 4);
 #endif // _SCHEDULER_H
@@ -0,0 +1,54 @@
+#include "statistics.h"
+
+using namespace computer_internal;
+
+constexpr const bool ExecutionStatistics::ENABLED;
+
+namespace computer_internal {
+CoreCounters::CoreCounters() {
+    clear();
+}
+
+void CoreCounters::clear() {
+    opcodes.fill(0);
+    timer_interrupts = 0;
+    slice = 0;
+}
+} // namespace computer_internal
+
+ExecutionStatistics::ExecutionStatistics() {
+    clear();
+}
+
+void ExecutionStatistics::clear(std::size_t processes) {
+    opcodes.fill(0);
+    this->processes.assign(processes, 0);
+    slices.clear();
+    context_switches = 0;
+    timer_interrupts = 0;
+}
+
+void ExecutionStatistics::writeJSON(std::ostream &stream) const {
+    stream << "{\"enabled\":" << (ENABLED ? "true" : "false");
+
+    stream << ",\"opcodes\":{";
+    for(std::size_t i = 0; i < opcodes.size(); ++i)
+        stream << (i ? "," : "") << '"' << mnemonic(static_cast<Opcode>(i))
+               << "\":" << opcodes[i];
+
+    stream << "},\"processes\":[";
+    for(std::size_t i = 0; i < processes.size(); ++i)
+        stream << (i ? "," : "") << processes[i];
+
+    stream << "],\"slices\":[";
+    for(std::size_t i = 0; i < slices.size(); ++i) {
+        const Slice &slice = slices[i];
+        stream << (i ? "," : "") << "{\"process\":" << slice.process
+               << ",\"core\":" << slice.core
+               << ",\"quantum\":" << slice.quantum
+               << ",\"instructions\":" << slice.instructions << '}';
+    }
+
+    stream << "],\"context_switches\":" << context_switches
+           << ",\"timer_interrupts\":" << timer_interrupts << "}\n";
+}
@@ -0,0 +1,62 @@
+#ifndef _STATISTICS_H
+#define _STATISTICS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "common.h"
+#include "instruction.h"
+
+namespace computer_internal {
+// The counters kept by a single core, which keeps none unless
+// COLLECT_STATISTICS
+struct CoreCounters {
+    // Indexed by the opcode, superinstructions are counted as the
+    // instructions they fuse
+    std::array<uint64_t, BASE_OPCODES> opcodes;
+    uint64_t timer_interrupts;
+    // The instructions executed since the current job was set
+    uint64_t slice;
+
+    CoreCounters();
+    void clear();
+};
+} // namespace computer_internal
+
+// The statistics of the last run of the programs. They are only collected
+// if the computer is built with COMPUTER_STATISTICS defined, otherwise all
+// of them stay empty.
+struct ExecutionStatistics {
+    constexpr static const bool ENABLED =
+        computer_internal::COLLECT_STATISTICS;
+
+    // A single scheduling decision
+    struct Slice {
+        pid_type process;
+        std::size_t core;
+        time_type quantum;
+        // The instructions executed until the process was preempted or
+        // finished (the slice in which an exception was thrown is missing)
+        uint64_t instructions;
+    };
+
+    // Indexed by the opcode. The instructions are counted once executed, so
+    // the one which throws (or the superinstruction it is a part of) is
+    // not counted.
+    std::array<uint64_t, computer_internal::BASE_OPCODES> opcodes;
+    // Indexed by the process
+    std::vector<uint64_t> processes;
+    // In the order of the decisions
+    std::vector<Slice> slices;
+    // The times a core started a process other than the one it ran before
+    uint64_t context_switches;
+    uint64_t timer_interrupts;
+
+    ExecutionStatistics();
+    void clear(std::size_t processes = 0);
+    void writeJSON(std::ostream &stream) const;
+};
+
+#endif // _STATISTICS_H
@@ -0,0 +1,97 @@
+#include "telemetry.h"
+
+#include <cmath>
+#include <limits>
+
+constexpr const std::size_t LatencyHistogram::BUCKETS;
+
+LatencyHistogram::LatencyHistogram() {
+    clear();
+}
+
+void LatencyHistogram::clear() {
+    buckets.fill(0);
+    samples = 0;
+    total = 0;
+    least = std::numeric_limits<uint64_t>::max();
+    greatest = 0;
+}
+
+std::size_t LatencyHistogram::bucket(uint64_t value) {
+    // The position of the most significant bit, found by a binary search
+    std::size_t result = 0;
+    for(std::size_t shift = 32; shift > 0; shift >>= 1) {
+        if(value >> shift) {
+            value >>= shift;
+            result += shift;
+        }
+    }
+    return result + (value != 0);
+}
+
+uint64_t LatencyHistogram::lowerBound(std::size_t bucket) {
+    return bucket ? uint64_t{1} << (bucket - 1) : 0;
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    ++buckets[bucket(value)];
+    ++samples;
+    total += value;
+    if(value < least)
+        least = value;
+    if(value > greatest)
+        greatest = value;
+}
+
+uint64_t LatencyHistogram::count() const {
+    return samples;
+}
+
+uint64_t LatencyHistogram::count(std::size_t bucket) const {
+    return buckets[bucket];
+}
+
+uint64_t LatencyHistogram::sum() const {
+    return total;
+}
+
+uint64_t LatencyHistogram::min() const {
+    return samples ? least : 0;
+}
+
+uint64_t LatencyHistogram::max() const {
+    return greatest;
+}
+
+double LatencyHistogram::mean() const {
+    return samples ? static_cast<double>(total) / samples : 0;
+}
+
+uint64_t LatencyHistogram::quantile(double q) const {
+    if(!samples)
+        return 0;
+
+    // The rank of the sample, counted from 1
+    uint64_t rank = static_cast<uint64_t>(std::ceil(q * samples));
+    if(rank == 0)
+        rank = 1;
+
+    uint64_t seen = 0;
+    for(std::size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets[i];
+        if(seen >= rank) {
+            // The greatest value of the bucket, but not above the maximum
+            uint64_t upper = i + 1 < BUCKETS ? lowerBound(i + 1) - 1
+                : std::numeric_limits<uint64_t>::max();
+            return upper < greatest ? upper : greatest;
+        }
+    }
+
+    return greatest;
+}
+
+void SchedulerTelemetry::clear() {
+    wait.clear();
+    response.clear();
+    turnaround.clear();
+}
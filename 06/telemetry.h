@@ -0,0 +1,58 @@
+#ifndef _TELEMETRY_H
+#define _TELEMETRY_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Histogram of non-negative values with buckets of exponentially growing
+// width: the bucket k > 0 holds the values from [2^(k-1), 2^k), the bucket 0
+// holds zeros. Recording a value takes constant time and no allocations.
+class LatencyHistogram {
+    public:
+    constexpr static const std::size_t BUCKETS = 65;
+
+    private:
+    std::array<uint64_t, BUCKETS> buckets;
+    uint64_t samples;
+    uint64_t total;
+    uint64_t least;
+    uint64_t greatest;
+
+    public:
+    LatencyHistogram();
+    void clear();
+    void record(uint64_t value);
+
+    static std::size_t bucket(uint64_t value);
+    // The least value which falls into the bucket
+    static uint64_t lowerBound(std::size_t bucket);
+
+    uint64_t count() const;
+    uint64_t count(std::size_t bucket) const;
+    uint64_t sum() const;
+    // Zero if nothing was recorded
+    uint64_t min() const;
+    uint64_t max() const;
+    double mean() const;
+    // An upper bound of the quantile (0 <= q <= 1), exact up to the width
+    // of the bucket
+    uint64_t quantile(double q) const;
+};
+
+// The latencies of the processes of the last run, measured in the emulated
+// time (the cycles executed, see CycleCosts). The clock is advanced by every
+// slice executed, so on a multi-core computer it measures the total time of
+// all the cores.
+struct SchedulerTelemetry {
+    // The total time each process spent in the ready queue
+    LatencyHistogram wait;
+    // The time until each process was run for the first time
+    LatencyHistogram response;
+    // The time until each process finished
+    LatencyHistogram turnaround;
+
+    void clear();
+};
+
+#endif // _TELEMETRY_H
@@ -0,0 +1,157 @@
+// Every lane of the batch prints, throws and leaves in its RAM what the
+// program does when run alone on a computer with the same RAM, also when
+// the lanes fault at different instructions or take different branches
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "batch.h"
+#include "test.h"
+
+namespace {
+const register_type REGISTERS = 6;
+const memory_type MEMORY = 8;
+
+// What a lane has shown, the RAM it was left with last
+struct Lane {
+    std::vector<number_type> printed;
+    std::string error;
+    std::vector<number_type> ram;
+
+    bool operator==(const Lane &that) const {
+        return printed == that.printed && error == that.error
+            && ram == that.ram;
+    }
+};
+
+// Runs the program on a computer of its own, the RAM set up by the
+// instructions in front of it and read by another program afterwards
+Lane alone(const std::string &code, const std::vector<number_type> &ram,
+           const CompilationOptions &options) {
+    Lane lane;
+    Computer computer = test::computer(REGISTERS, MEMORY);
+    auto os = computer.installOS(createFCFSScheduling());
+    os->setCompilationOptions(options);
+    os->setOutput(std::make_shared<CallbackOutput>(
+        [&lane](pid_type, number_type value) {
+            lane.printed.push_back(value);
+        }));
+
+    std::ostringstream setup;
+    for(memory_type address = 0; address < MEMORY; ++address)
+        setup << "SET R1 " << ram[address] << "\nSTORE M" << address
+              << " R1\n";
+    setup << "SET R1 0\n";
+    try {
+        os->executePrograms({setup.str() + code});
+    }
+    catch(...) {
+        lane.error = test::describe(std::current_exception());
+    }
+
+    std::ostringstream dump;
+    for(memory_type address = 0; address < MEMORY; ++address)
+        dump << "LOAD R1 M" << address << "\nPRINTLN R1\n";
+    os->setOutput(std::make_shared<CallbackOutput>(
+        [&lane](pid_type, number_type value) {
+            lane.ram.push_back(value);
+        }));
+    os->executePrograms({dump.str()});
+    return lane;
+}
+
+// Runs the program on a batch with a lane per RAM, compares every lane with
+// the program run alone and returns the number of the distinct lanes
+std::size_t compare(const std::string &code,
+                    const std::vector<std::vector<number_type>> &rams) {
+    std::size_t distinct = 0;
+    for(bool fuse : {false, true}) {
+        CompilationOptions options;
+        options.fuse_instructions = fuse;
+
+        ComputerBatch batch{REGISTERS, MEMORY, rams.size()};
+        batch.setCompilationOptions(options);
+        std::vector<Lane> lanes(rams.size());
+        batch.setOutput(std::make_shared<CallbackOutput>(
+            [&lanes](pid_type lane, number_type value) {
+                lanes[lane].printed.push_back(value);
+            }));
+        for(std::size_t lane = 0; lane < rams.size(); ++lane)
+            for(memory_type address = 0; address < MEMORY; ++address)
+                batch.store(lane, address, rams[lane][address]);
+
+        auto errors = batch.execute(code);
+        CHECK(errors.size() == rams.size());
+
+        std::vector<Lane> seen;
+        for(std::size_t lane = 0; lane < rams.size(); ++lane) {
+            lanes[lane].error = test::describe(errors[lane]);
+            for(memory_type address = 0; address < MEMORY; ++address)
+                lanes[lane].ram.push_back(batch.load(lane, address));
+            CHECK(lanes[lane] == alone(code, rams[lane], options));
+
+            bool found = false;
+            for(const auto &other : seen)
+                found = found || other == lanes[lane];
+            if(!found)
+                seen.push_back(lanes[lane]);
+        }
+        distinct = seen.size();
+    }
+    return distinct;
+}
+
+// The lanes leave the program, fault and come back at different points
+void divergence() {
+    std::string code =
+        "LOAD R1 M0\n"
+        "LOAD R2 M1\n"
+        "JZ R1 zero\n"
+        "PRINTLN R1\n"
+        "JNZ R2 skip\n"
+        "DIV R1 R2\n"
+        "skip: PRINTLN R2\n"
+        "zero: SET R3 60\n"
+        "LOAD R4 M2\n"
+        "DIV R3 R4\n"
+        "PRINTLN R3\n"
+        "STORE M3 R3\n"
+        "LOAD R5 M4\n"
+        "loop: JZ R5 end\n"
+        "SET R6 1\n"
+        "SUB R5 R6\n"
+        "STORE M5 R5\n"
+        "ADD R3 R3\n"
+        "PRINTLN R3\n"
+        "JMP loop\n"
+        "end: LOAD R6 M" + std::to_string(MEMORY) + "\n";
+
+    std::vector<std::vector<number_type>> rams;
+    for(number_type first : {0, 7})
+        for(number_type second : {0, 2})
+            for(number_type third : {0, 5, -4})
+                for(number_type count : {0, 1, 3})
+                    rams.push_back({first, second, third, 0, count, 9, 0, 0});
+    CHECK(compare(code, rams) > 10);
+}
+
+// The random programs, their jumps and faults depend on the values loaded
+void randomPrograms() {
+    std::mt19937 random{2017};
+    for(unsigned round = 0; round < 200; ++round) {
+        std::string code = test::randomProgram(random, 40, REGISTERS, MEMORY,
+                                               true);
+        std::vector<std::vector<number_type>> rams(1 + round % 19);
+        for(auto &ram : rams)
+            for(memory_type address = 0; address < MEMORY; ++address)
+                ram.push_back(static_cast<number_type>(random() % 7) - 3);
+        compare(code, rams);
+    }
+}
+} // namespace
+
+int main() {
+    divergence();
+    randomPrograms();
+    return test::finish();
+}
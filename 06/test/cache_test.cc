@@ -0,0 +1,89 @@
+// The modeled caches count the hits, the misses and the cycles of every
+// level, the memory past the last level included
+#include "cache_model.h"
+#include "test.h"
+
+using computer_internal::CacheModel;
+
+namespace {
+// Two levels of a line of four cells each, the first one direct-mapped
+CacheConfiguration configuration() {
+    CacheConfiguration result;
+    result.levels = {CacheLevel{2, 1, 4, 1}, CacheLevel{1, 4, 4, 10}};
+    result.memory_latency = 100;
+    result.ranges = {8};
+    return result;
+}
+
+void counters() {
+    CacheModel model{configuration(), 2};
+    // The lines 0, 0, 2 (replacing 0 in the first level), 0, 1, 1, 5
+    for(memory_type address : {0, 1, 8, 0, 4, 5, 20})
+        model.access(address == 20, address);
+
+    const CacheCounters &total = model.statistics().total;
+    CHECK(total.accesses == 7);
+    CHECK(total.hits == (std::vector<uint64_t>{2, 1}));
+    CHECK(total.cycles == 7 * 1 + 5 * 10 + 4 * 100);
+
+    CHECK(total.reached(0) == 7 && total.misses(0) == 5);
+    CHECK(total.reached(1) == 5 && total.misses(1) == 4);
+    CHECK(total.hitRate(1) == 0.2 && total.missRate(1) == 0.8);
+
+    // The memory serves everything which gets to it
+    CHECK(total.reached(2) == 4 && total.served(2) == 4);
+    CHECK(total.misses(2) == 0);
+    CHECK(total.hitRate(2) == 1 && total.missRate(2) == 0);
+
+    const CacheCounters &process = model.statistics().processes[1];
+    CHECK(process.accesses == 1 && process.misses(2) == 0);
+    CHECK(process.hitRate(2) == 1);
+
+    // Neither rate is defined for a level nothing got to
+    const CacheCounters &range = model.statistics().ranges[0];
+    CHECK(range.accesses == 5 && range.reached(2) == 2);
+    CacheCounters none{2};
+    CHECK(none.misses(2) == 0);
+    CHECK(none.hitRate(2) == 0 && none.missRate(2) == 0);
+}
+
+// The counters without any levels have only the memory
+void memoryOnly() {
+    CacheConfiguration uncached;
+    uncached.memory_latency = 3;
+    CacheModel model{uncached, 1};
+    model.access(0, 5);
+    model.access(0, 5);
+
+    const CacheCounters &total = model.statistics().total;
+    CHECK(total.hits.empty() && total.cycles == 6);
+    CHECK(total.reached(0) == 2 && total.misses(0) == 0);
+    CHECK(total.hitRate(0) == 1 && total.missRate(0) == 0);
+}
+
+// The processes run by the OS are counted the same way
+void processes() {
+    Computer computer = test::computer(2, 32);
+    auto os = computer.installOS(createFCFSScheduling());
+    os->setCacheModel(std::make_shared<CacheConfiguration>(configuration()));
+    os->setOutput(std::make_shared<CapturedOutput>());
+    os->executePrograms({"LOAD R1 M0\nLOAD R1 M1\nSTORE M8 R1\n",
+                         "LOAD R1 M0\n"});
+
+    const CacheStatistics &statistics = os->cacheStatistics();
+    CHECK(statistics.total.accesses == 4);
+    CHECK(statistics.total.hits == (std::vector<uint64_t>{1, 1}));
+    CHECK(statistics.processes.size() == 2);
+    CHECK(statistics.processes[1].hits == (std::vector<uint64_t>{0, 1}));
+    CHECK(statistics.processes[1].misses(2) == 0);
+    CHECK(statistics.total.misses(2) == 0);
+    CHECK(statistics.total.hitRate(2) == 1);
+}
+} // namespace
+
+int main() {
+    counters();
+    memoryOnly();
+    processes();
+    return test::finish();
+}
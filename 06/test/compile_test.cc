@@ -0,0 +1,118 @@
+// The programs compiled in parallel run like the ones compiled one by one,
+// and the exception of the first program which fails is the one thrown
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <random>
+#include <string>
+#include "test.h"
+
+namespace {
+const register_type REGISTERS = 6;
+const memory_type MEMORY = 32;
+// Enough to be split between the threads of the pool
+const unsigned PROGRAMS = 2000;
+
+std::list<std::string> programs() {
+    std::mt19937 random{2017};
+    std::list<std::string> result;
+    for(unsigned i = 0; i < PROGRAMS; ++i)
+        result.push_back(test::randomProgram(random, 20, REGISTERS, MEMORY,
+                                             false));
+    return result;
+}
+
+std::string& at(std::list<std::string> &list, std::size_t index) {
+    return *std::next(list.begin(), index);
+}
+
+template<class Exception>
+std::string describe(const Exception &exception) {
+    return test::describe(std::make_exception_ptr(exception));
+}
+
+// Runs the programs with a fresh OS, each of them written to a file if the
+// files are run
+test::Outcome execute(const std::list<std::string> &sources, bool cache,
+                      bool files) {
+    test::Outcome outcome;
+    Computer computer = test::computer(REGISTERS, MEMORY);
+    auto os = computer.installOS(createFCFSScheduling());
+    if(cache)
+        os->setProgramCache(std::make_shared<ProgramCache>(1 << 20));
+    os->setOutput(std::make_shared<CallbackOutput>(
+        [&outcome](pid_type process, number_type value) {
+            outcome.lines.emplace_back(process, value);
+        }));
+
+    std::list<std::string> paths;
+    if(files) {
+        for(const auto &source : sources) {
+            paths.push_back("compile_test_" + std::to_string(paths.size())
+                            + ".asm");
+            std::ofstream{paths.back()} << source;
+        }
+    }
+
+    try {
+        if(files)
+            os->executeProgramFiles(paths);
+        else
+            os->executePrograms(sources);
+    }
+    catch(...) {
+        outcome.error = test::describe(std::current_exception());
+    }
+
+    for(const auto &path : paths)
+        std::remove(path.c_str());
+    return outcome;
+}
+
+void compilation() {
+    auto sources = programs();
+    at(sources, 1500) = "FOO R1\n";
+    at(sources, 300) = "JMP nowhere\n";
+    at(sources, 301) = "SET R1 x\n";
+
+    for(bool cache : {false, true}) {
+        for(bool files : {false, true}) {
+            auto outcome = execute(sources, cache, files);
+            CHECK(outcome.error == describe(UndefinedLabelException{"nowhere"}));
+            // None of the programs was run
+            CHECK(outcome.lines.empty());
+        }
+    }
+}
+
+void execution() {
+    auto sources = programs();
+    auto expected = execute(sources, false, false);
+    CHECK(expected.error.empty());
+
+    // The first one run is the first one on the list
+    at(sources, 900) += "LOAD R1 M" + std::to_string(MEMORY) + "\n";
+    at(sources, 500) += "PRINTLN R" + std::to_string(REGISTERS + 1) + "\n";
+    for(bool cache : {false, true}) {
+        auto outcome = execute(sources, cache, false);
+        CHECK(outcome.error
+              == describe(InvalidRegisterException{REGISTERS + 1}));
+
+        // Everything printed before the fault is there
+        std::size_t printed = 0;
+        while(printed < expected.lines.size()
+              && expected.lines[printed].first <= 500)
+            ++printed;
+        decltype(outcome.lines) before(expected.lines.begin(),
+                                       expected.lines.begin() + printed);
+        CHECK(outcome.lines == before);
+    }
+}
+} // namespace
+
+int main() {
+    compilation();
+    execution();
+    return test::finish();
+}
@@ -0,0 +1,139 @@
+// The processes run on many cores behave like on a single one, and the
+// exception of the process which fails is the one reported
+#include <list>
+#include <random>
+#include <sstream>
+#include <string>
+#include "test.h"
+
+namespace {
+const register_type REGISTERS = 4;
+const memory_type CELLS = 8;
+const unsigned PROGRAMS = 48;
+
+// A straight-line program which sets all the registers before reading any
+// and only touches its own memory cells, so that its output does not
+// depend on the other processes unless it is preempted
+std::string program(std::mt19937 &random, unsigned index, unsigned length) {
+    std::ostringstream code;
+    for(register_type reg = 1; reg <= REGISTERS; ++reg)
+        code << "SET R" << reg << ' ' << index + reg << '\n';
+
+    for(unsigned i = 0; i < length; ++i) {
+        auto reg = [&random]() { return random() % REGISTERS + 1; };
+        memory_type cell = index * CELLS + random() % CELLS;
+        switch(random() % 6) {
+            case 0:
+                code << "LOAD R" << reg() << " M" << cell << '\n';
+                break;
+            case 1:
+                code << "STORE M" << cell << " R" << reg() << '\n';
+                break;
+            case 2:
+                code << "ADD R" << reg() << " R" << reg() << '\n';
+                break;
+            case 3:
+                code << "MUL R" << reg() << " R" << reg() << '\n';
+                break;
+            case 4:
+                code << "SET R" << reg() << ' ' << random() % 100 << '\n';
+                break;
+            default:
+                code << "PRINTLN R" << reg() << '\n';
+                break;
+        }
+    }
+    return code.str();
+}
+
+std::list<std::string> programs(unsigned seed) {
+    std::mt19937 random{seed};
+    std::list<std::string> result;
+    for(unsigned i = 0; i < PROGRAMS; ++i)
+        result.push_back(program(random, i, 50 + random() % 100));
+    return result;
+}
+
+void nonPreemptive() {
+    auto sources = programs(2017);
+    for(bool native : {false, true}) {
+        CompilationOptions options;
+        options.native_code = native;
+        auto expected = test::execute(
+            test::computer(REGISTERS, PROGRAMS * CELLS),
+            createFCFSScheduling(), options, sources);
+        CHECK(expected.error.empty() && !expected.lines.empty());
+
+        for(unsigned cores : {2, 3, 8}) {
+            Computer machine = test::computer(REGISTERS, PROGRAMS * CELLS,
+                                              cores);
+            auto fcfs = test::execute(machine, createFCFSScheduling(),
+                                      options, sources);
+            auto sjf = test::execute(machine, createSJFScheduling(),
+                                     options, sources);
+            for(pid_type process = 0; process < PROGRAMS; ++process) {
+                CHECK(fcfs.printed(process) == expected.printed(process));
+                CHECK(sjf.printed(process) == expected.printed(process));
+            }
+            CHECK(fcfs.cycles == expected.cycles);
+            CHECK(sjf.cycles == expected.cycles);
+            CHECK(fcfs.error.empty() && sjf.error.empty());
+        }
+    }
+}
+
+// The values printed depend on the registers left by the other processes,
+// but their number and the time taken do not
+void preemptive() {
+    auto sources = programs(2018);
+    auto expected = test::execute(test::computer(REGISTERS, PROGRAMS * CELLS),
+                                  createFCFSScheduling(), CompilationOptions{},
+                                  sources);
+
+    std::vector<std::function<std::shared_ptr<SchedulingAlgorithm>()>>
+        algorithms = {
+        []() { return createRRScheduling(3); },
+        []() { return createMLFQScheduling(2, 3, 50); },
+        []() { return createCFSScheduling(24, 2); },
+    };
+    for(const auto &algorithm : algorithms) {
+        for(unsigned cores : {1, 2, 4}) {
+            auto outcome = test::execute(
+                test::computer(REGISTERS, PROGRAMS * CELLS, cores),
+                algorithm(), CompilationOptions{}, sources);
+            CHECK(outcome.error.empty());
+            CHECK(outcome.cycles == expected.cycles);
+            for(pid_type process = 0; process < PROGRAMS; ++process)
+                CHECK(outcome.printed(process).size()
+                      == expected.printed(process).size());
+        }
+    }
+}
+
+void failure() {
+    auto sources = programs(2019);
+    auto failing = sources.begin();
+    std::advance(failing, PROGRAMS / 2);
+    *failing += "SET R1 0\nDIV R2 R1\n";
+
+    for(unsigned cores : {1, 2, 4}) {
+        for(bool native : {false, true}) {
+            CompilationOptions options;
+            options.native_code = native;
+            auto outcome = test::execute(
+                test::computer(REGISTERS, PROGRAMS * CELLS, cores),
+                createRRScheduling(5), options, sources);
+            CHECK(outcome.error
+                  == test::describe(std::make_exception_ptr(
+                      DivisionByZeroException{})));
+        }
+    }
+}
+} // namespace
+
+int main() {
+    nonPreemptive();
+    preemptive();
+    failure();
+    return test::finish();
+}
@@ -0,0 +1,117 @@
+// The cycles of the processes and the time slices follow the costs set for
+// the instructions, both interpreted and translated into the machine code
+#include <list>
+#include <string>
+#include <utility>
+#include "test.h"
+
+namespace {
+Computer machine() {
+    CycleCosts costs;
+    costs.set("ADD", 3);
+    costs.set("SUB", 2);
+    costs.set("MUL", 5);
+    costs.set("DIV", 7);
+    costs.set("PRINTLN", 2);
+    costs.set("JNZ", 4);
+
+    Computer result = test::computer(4, 16);
+    result.setCycleCosts(costs);
+    return result;
+}
+
+test::Outcome execute(std::shared_ptr<SchedulingAlgorithm> scheduling,
+                      bool native, const std::list<std::string> &programs) {
+    CompilationOptions options;
+    options.native_code = native;
+    return test::execute(machine(), scheduling, options, programs);
+}
+
+// The processes which printed the values, one digit each
+std::string order(const test::Outcome &outcome) {
+    std::string result;
+    for(const auto &line : outcome.lines)
+        result += std::to_string(line.first);
+    return result;
+}
+
+// An addition and a print, five cycles, repeated
+std::string pairs(unsigned count) {
+    std::string code;
+    for(unsigned i = 0; i < count; ++i)
+        code += "ADD R1 R2\nPRINTLN R1\n";
+    return code;
+}
+
+void cycles() {
+    std::list<std::string> programs = {
+        "SET R1 4\nSET R2 2\nMUL R1 R2\nPRINTLN R1\nDIV R1 R2\nPRINTLN R1\n",
+        "SET R1 3\nSET R2 1\nloop: SUB R1 R2\nPRINTLN R1\nJNZ R1 loop\n",
+        pairs(40),
+    };
+    for(bool native : {false, true}) {
+        auto outcome = execute(createFCFSScheduling(), native, programs);
+        CHECK(outcome.error.empty());
+        CHECK(outcome.cycles
+              == (std::vector<uint64_t>{18, 1 + 1 + 3 * (2 + 2 + 4), 200}));
+    }
+}
+
+// The slice goes on while some of its cycles are left, the last instruction
+// may take more than that
+void slices() {
+    std::list<std::string> programs = {pairs(6), pairs(6)};
+    for(bool native : {false, true}) {
+        auto outcome = execute(createRRScheduling(6), native, programs);
+        CHECK(order(outcome) == "0" "1" "00" "11" "0" "1" "00" "11");
+        CHECK(outcome.cycles == (std::vector<uint64_t>{30, 30}));
+    }
+
+    // The slices longer than a block of the machine code
+    programs = {pairs(40), pairs(40)};
+    for(bool native : {false, true}) {
+        auto outcome = execute(createRRScheduling(100), native, programs);
+        CHECK(order(outcome) == std::string(20, '0') + std::string(20, '1')
+                                + std::string(20, '0') + std::string(20, '1'));
+        CHECK(outcome.cycles == (std::vector<uint64_t>{200, 200}));
+    }
+
+    for(time_type quantum : {4, 7, 33, 64, 81}) {
+        auto interpreted = execute(createRRScheduling(quantum), false,
+                                   programs);
+        CHECK(execute(createRRScheduling(quantum), true, programs)
+              == interpreted);
+        CHECK(interpreted.cycles == (std::vector<uint64_t>{200, 200}));
+    }
+}
+
+// The slice the process faulted in is not counted. The slices of seven
+// cycles take eight and seven cycles in turns, three instructions each.
+void faults() {
+    std::list<std::string> programs = {
+        pairs(20) + "SET R3 0\nDIV R1 R3\n" + pairs(20), pairs(3)
+    };
+    std::pair<time_type, uint64_t> slices[] = {
+        {7, 7 * 8 + 6 * 7}, {100, 100}
+    };
+    for(const auto &slice : slices) {
+        auto interpreted = execute(createRRScheduling(slice.first), false,
+                                   programs);
+        auto native = execute(createRRScheduling(slice.first), true,
+                              programs);
+        CHECK(native == interpreted);
+        CHECK(interpreted.error == test::describe(std::make_exception_ptr(
+            DivisionByZeroException{})));
+        CHECK(interpreted.printed(0).size() == 20);
+        CHECK(interpreted.cycles
+              == (std::vector<uint64_t>{slice.second, 15}));
+    }
+}
+} // namespace
+
+int main() {
+    cycles();
+    slices();
+    faults();
+    return test::finish();
+}
@@ -0,0 +1,113 @@
+// Every job of the farm gets the output and the exception it would get run
+// alone, and the thread pool reports the exception of the first failed task
+#include <atomic>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "farm.h"
+#include "test.h"
+#include "thread_pool.h"
+
+namespace {
+const register_type REGISTERS = 6;
+const memory_type MEMORY = 32;
+
+// What the job shows when run on its own
+ComputerFarm::Result alone(const ComputerFarm::Job &job) {
+    ComputerFarm::Result result;
+    std::ostringstream output;
+    try {
+        Computer computer{job.machine};
+        auto os = computer.installOS(job.scheduling());
+        os->setCompilationOptions(job.options);
+        os->setOutput(std::make_shared<BufferedOutput>(output));
+        os->executePrograms(job.programs);
+    }
+    catch(...) {
+        result.error = std::current_exception();
+    }
+    result.output = output.str();
+    return result;
+}
+
+void farm() {
+    std::mt19937 random{2017};
+    auto cache = std::make_shared<ProgramCache>(1 << 20);
+
+    std::vector<ComputerFarm::Job> jobs(60);
+    for(std::size_t i = 0; i < jobs.size(); ++i) {
+        ComputerFarm::Job &job = jobs[i];
+        job.machine = test::computer(REGISTERS, MEMORY, 1 + i % 2);
+        if(i % 3 == 0)
+            job.scheduling = []() { return createFCFSScheduling(); };
+        else
+            job.scheduling = [i]() { return createRRScheduling(1 + i % 5); };
+        for(unsigned j = 0; j < 1 + i % 3; ++j)
+            job.programs.push_back(test::randomProgram(random, 60, REGISTERS,
+                                                       MEMORY, true));
+        job.options.native_code = i % 4 == 1;
+        job.cache = i % 2 ? cache : nullptr;
+    }
+
+    ComputerFarm farm{4};
+    auto results = farm.run(jobs);
+    CHECK(results.size() == jobs.size());
+
+    unsigned compared = 0, failed = 0;
+    for(std::size_t i = 0; i < jobs.size(); ++i) {
+        // The processes of the multi-core jobs may interleave differently
+        if(jobs[i].programs.size() > 1 && i % 2)
+            continue;
+
+        auto expected = alone(jobs[i]);
+        CHECK(results[i].output == expected.output);
+        CHECK(test::describe(results[i].error)
+              == test::describe(expected.error));
+        ++compared;
+        failed += expected.error != nullptr;
+    }
+    // Both kinds of jobs were there
+    CHECK(failed > 0 && failed < compared);
+}
+
+void pool() {
+    computer_internal::ThreadPool pool{4};
+
+    for(unsigned round = 0; round < 50; ++round) {
+        std::atomic<unsigned> finished{0};
+        std::vector<computer_internal::ThreadPool::task_type> tasks;
+        for(unsigned i = 0; i < 100; ++i)
+            tasks.push_back([&finished, &pool, i, round]() {
+                // The later tasks fail sooner
+                if(i == 99 || i == 60 + round % 30)
+                    throw std::runtime_error("task " + std::to_string(i));
+                if(i == 17 + round % 20) {
+                    // Some of the tasks use the pool too
+                    std::vector<computer_internal::ThreadPool::task_type>
+                        nested(8, []() { });
+                    nested[5] = []() { throw std::logic_error("nested"); };
+                    pool.run(nested);
+                }
+                ++finished;
+            });
+
+        std::string error;
+        try {
+            pool.run(tasks);
+        }
+        catch(const std::exception &exception) {
+            error = exception.what();
+        }
+        CHECK(error == "nested");
+        CHECK(finished == 97);
+    }
+}
+} // namespace
+
+int main() {
+    farm();
+    pool();
+    return test::finish();
+}
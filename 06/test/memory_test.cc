@@ -0,0 +1,124 @@
+// The copies of the RAM (and of the computers) do not see each other's
+// writes, also when many cores write to a shared page table at once
+#include <list>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "memory.h"
+#include "test.h"
+
+using computer_internal::RAM;
+
+namespace {
+// Spans several tables of the page table
+const memory_type SIZE = 3 << 20;
+
+const memory_type ADDRESSES[] = {
+    0, 1, 1023, 1024, 5000, (1 << 20) - 1, 1 << 20, (2 << 20) + 17, SIZE - 1
+};
+
+void copies() {
+    RAM original{SIZE};
+    for(memory_type address : ADDRESSES)
+        original.store(address, address % 1000 + 1);
+
+    RAM copy{original};
+    for(memory_type address : ADDRESSES)
+        CHECK(copy.load(address) == address % 1000 + 1);
+
+    // The pages written, the ones shared and the ones never allocated
+    original.store(0, -1);
+    copy.store(1, -2);
+    copy.store(3 << 19, -3);
+    original.store(2 << 20, -4);
+    CHECK(original.load(0) == -1 && copy.load(0) == 1);
+    CHECK(original.load(1) == 2 && copy.load(1) == -2);
+    CHECK(original.load(3 << 19) == 0 && copy.load(3 << 19) == -3);
+    CHECK(original.load(2 << 20) == -4 && copy.load(2 << 20) == 0);
+    CHECK(original.load(1023) == copy.load(1023));
+
+    RAM second{copy};
+    second.store(SIZE - 1, -5);
+    CHECK(copy.load(SIZE - 1) == (SIZE - 1) % 1000 + 1);
+    CHECK(second.load(1) == -2 && second.load(SIZE - 1) == -5);
+
+    RAM assigned{16};
+    assigned = original;
+    assigned.store(0, -6);
+    CHECK(original.load(0) == -1 && assigned.load(0) == -6);
+    CHECK(assigned.size() == SIZE);
+
+    copy.clear();
+    CHECK(copy.load(1024) == 0 && original.load(1024) == 1024 % 1000 + 1);
+    CHECK(second.load(1024) == 1024 % 1000 + 1);
+
+    original.compact();
+    second.compact();
+    CHECK(second.load(5000) == 5000 % 1000 + 1);
+}
+
+void computers() {
+    Computer first = test::computer(4, 64);
+    auto os = first.installOS(createFCFSScheduling());
+    os->setOutput(std::make_shared<CapturedOutput>());
+    os->executePrograms({"SET R1 1\nSTORE M0 R1\n"});
+
+    // The copy is taken while the RAM of the original holds the value
+    Computer second{first};
+    auto other = second.installOS(createFCFSScheduling());
+    auto printed = std::make_shared<CapturedOutput>();
+    other->setOutput(printed);
+    other->executePrograms({"LOAD R1 M0\nPRINTLN R1\nSET R1 2\nSTORE M0 R1\n"});
+    CHECK(printed->printed(0) == std::vector<number_type>{0});
+
+    os->executePrograms({"SET R1 3\nSTORE M1 R1\n"});
+    other->executePrograms({"LOAD R1 M1\nPRINTLN R1\n"});
+    CHECK(printed->printed(0) == (std::vector<number_type>{0, 0}));
+
+    printed = std::make_shared<CapturedOutput>();
+    os->setOutput(printed);
+    os->executePrograms({"LOAD R1 M0\nPRINTLN R1\nLOAD R1 M1\nPRINTLN R1\n"});
+    CHECK(printed->printed(0) == (std::vector<number_type>{1, 3}));
+}
+
+// Every thread writes its own words, spread over the same pages, while the
+// whole page table is shared with a copy
+void concurrent() {
+    const unsigned THREADS = 8;
+    const memory_type WORDS = 20000;
+
+    for(unsigned round = 0; round < 20; ++round) {
+        RAM memory{SIZE};
+        for(memory_type word = 0; word < WORDS; ++word)
+            memory.store(word * 97 % SIZE, -1);
+        RAM copy{memory};
+
+        std::vector<std::thread> threads;
+        for(unsigned thread = 0; thread < THREADS; ++thread)
+            threads.emplace_back([&memory, thread, round]() {
+                for(memory_type word = thread; word < WORDS; word += THREADS)
+                    memory.storeUnchecked(word * 97 % SIZE,
+                                          word + static_cast<memory_type>(round));
+            });
+        for(auto &thread : threads)
+            thread.join();
+        memory.compact();
+
+        unsigned wrong = 0;
+        for(memory_type word = 0; word < WORDS; ++word) {
+            wrong += memory.load(word * 97 % SIZE)
+                != word + static_cast<memory_type>(round);
+            wrong += copy.load(word * 97 % SIZE) != -1;
+        }
+        CHECK(wrong == 0);
+    }
+}
+} // namespace
+
+int main() {
+    copies();
+    computers();
+    concurrent();
+    return test::finish();
+}
@@ -0,0 +1,155 @@
+// The programs translated into the machine code of the host run like the
+// interpreted ones: the same values printed in the same order, the same
+// exceptions and the same cycles, also when the timer expires in the middle
+// of a block of the machine code
+#include <list>
+#include <random>
+#include <sstream>
+#include <string>
+#include "test.h"
+
+namespace {
+const register_type REGISTERS = 5;
+const memory_type MEMORY = 24;
+
+// The time slices shorter than a block, the same and longer
+const time_type QUANTA[] = {1, 2, 3, 5, 7, 31, 32, 33, 100};
+
+// A program without any jumps, so that all of it is translated. It is
+// longer than a few blocks of the machine code.
+std::string straightLine(std::mt19937 &random, unsigned length) {
+    std::ostringstream code;
+    for(register_type reg = 1; reg <= REGISTERS; ++reg)
+        code << "SET R" << reg << ' ' << random() % 7 + 1 << '\n';
+
+    auto reg = [&random]() { return random() % REGISTERS + 1; };
+    for(unsigned i = 0; i < length; ++i) {
+        switch(random() % 7) {
+            case 0:
+                code << "LOAD R" << reg() << " M" << random() % MEMORY << '\n';
+                break;
+            case 1:
+                code << "STORE M" << random() % MEMORY << " R" << reg() << '\n';
+                break;
+            case 2:
+                code << "ADD R" << reg() << " R" << reg() << '\n';
+                break;
+            case 3:
+                code << "SUB R" << reg() << " R" << reg() << '\n';
+                break;
+            case 4:
+                code << "MUL R" << reg() << " R" << reg() << '\n';
+                break;
+            case 5:
+                code << "SET R" << reg() << ' ' << random() % 100 << '\n';
+                break;
+            default:
+                code << "PRINTLN R" << reg() << '\n';
+                break;
+        }
+    }
+    return code.str();
+}
+
+test::Outcome execute(std::shared_ptr<SchedulingAlgorithm> scheduling,
+                      bool native, const std::list<std::string> &programs) {
+    CompilationOptions options;
+    options.native_code = native;
+    return test::execute(test::computer(REGISTERS, MEMORY), scheduling,
+                         options, programs);
+}
+
+// Runs the programs interpreted and translated, under FCFS and round robin
+// with each of the quanta
+void compare(const std::list<std::string> &programs) {
+    auto expected = execute(createFCFSScheduling(), false, programs);
+    CHECK(execute(createFCFSScheduling(), true, programs) == expected);
+
+    for(time_type quantum : QUANTA) {
+        expected = execute(createRRScheduling(quantum), false, programs);
+        CHECK(execute(createRRScheduling(quantum), true, programs)
+              == expected);
+    }
+}
+
+void straightLines() {
+    std::mt19937 random{2017};
+    for(unsigned round = 0; round < 20; ++round) {
+        std::list<std::string> programs;
+        for(unsigned i = 0; i < 1 + round % 4; ++i)
+            programs.push_back(straightLine(random, 40 + random() % 120));
+        compare(programs);
+    }
+}
+
+// Only the part before the first jump is translated, the faults may be in
+// either part
+void randomPrograms() {
+    std::mt19937 random{2018};
+    unsigned failed = 0;
+    for(unsigned round = 0; round < 60; ++round) {
+        std::list<std::string> programs;
+        for(unsigned i = 0; i < 1 + round % 3; ++i)
+            programs.push_back(straightLine(random, random() % 70)
+                               + test::randomProgram(random, 60, REGISTERS,
+                                                     MEMORY, true));
+        compare(programs);
+        failed += !execute(createFCFSScheduling(), false, programs)
+                       .error.empty();
+    }
+    // Some of the programs did fault
+    CHECK(failed > 0);
+}
+
+// The faults in the first block, at the end of one and deep inside the code,
+// also after the process was preempted in the same block
+void faults() {
+    std::mt19937 random{2019};
+    const std::string faulty[] = {
+        "SET R1 0\nDIV R2 R1\n",
+        "SET R1 5\nSUB R1 R1\nDIV R3 R1\n",
+        "LOAD R1 M" + std::to_string(MEMORY) + "\n",
+        "PRINTLN R" + std::to_string(REGISTERS + 1) + "\n",
+    };
+    for(const auto &fault : faulty) {
+        for(unsigned length : {0, 20, 29, 30, 31, 45, 62, 100}) {
+            std::list<std::string> programs = {
+                straightLine(random, 50),
+                straightLine(random, length) + fault + "PRINTLN R1\n",
+                straightLine(random, 70),
+            };
+            auto expected = execute(createFCFSScheduling(), false, programs);
+            CHECK(!expected.error.empty());
+            compare(programs);
+        }
+    }
+}
+
+// The processes which print their values interleave by the time slices, the
+// preemption inside a block included
+void preemption() {
+    std::string code;
+    for(unsigned i = 0; i < 80; ++i)
+        code += i % 3 ? "ADD R1 R2\n" : "PRINTLN R1\n";
+    std::list<std::string> programs = {
+        "SET R2 1\n" + code, "SET R2 2\n" + code
+    };
+
+    for(time_type quantum : QUANTA) {
+        auto interpreted = execute(createRRScheduling(quantum), false,
+                                   programs);
+        auto native = execute(createRRScheduling(quantum), true, programs);
+        CHECK(native == interpreted);
+        CHECK(native.error.empty());
+        CHECK(native.lines.size() == 2 * 27);
+    }
+}
+} // namespace
+
+int main() {
+    straightLines();
+    randomPrograms();
+    faults();
+    preemption();
+    return test::finish();
+}
@@ -0,0 +1,141 @@
+// The optimized programs print the same values and throw the same exceptions
+// as the original ones, and the optimizer is not used where other processes
+// could see the difference
+#include <cstdio>
+#include <list>
+#include <random>
+#include <string>
+#include "test.h"
+
+namespace {
+const register_type REGISTERS = 8;
+const memory_type MEMORY = 64;
+
+CompilationOptions options(bool optimize, bool fuse) {
+    CompilationOptions result;
+    result.optimize = optimize;
+    result.fuse_instructions = fuse;
+    return result;
+}
+
+uint64_t total(const std::vector<uint64_t> &cycles) {
+    uint64_t result = 0;
+    for(uint64_t value : cycles)
+        result += value;
+    return result;
+}
+
+// The processes are run one after another, so the optimizer is used
+void sequential() {
+    std::mt19937 random{2017};
+    Computer machine = test::computer(REGISTERS, MEMORY);
+
+    for(unsigned round = 0; round < 400; ++round) {
+        std::list<std::string> programs;
+        for(unsigned i = 0; i < 1 + round % 3; ++i)
+            programs.push_back(test::randomProgram(random, 40, REGISTERS,
+                                                   MEMORY, true));
+
+        for(bool fuse : {false, true}) {
+            auto plain = test::execute(machine, createFCFSScheduling(),
+                                       options(false, fuse), programs);
+            auto optimized = test::execute(machine, createFCFSScheduling(),
+                                           options(true, fuse), programs);
+            CHECK(optimized.lines == plain.lines);
+            CHECK(optimized.error == plain.error);
+        }
+    }
+
+    // The dead writes are gone
+    std::list<std::string> programs = {"SET R1 1\nSET R1 2\nPRINTLN R1\n"};
+    auto plain = test::execute(machine, createFCFSScheduling(),
+                               options(false, false), programs);
+    auto optimized = test::execute(machine, createFCFSScheduling(),
+                                   options(true, false), programs);
+    CHECK(optimized.lines == plain.lines);
+    CHECK(total(optimized.cycles) < total(plain.cycles));
+}
+
+// The value stored by the first process is overwritten by the second one
+// before it is loaded again, forwarding it would print 5
+void preemptive() {
+    std::list<std::string> programs = {
+        "SET R1 5\nSTORE M0 R1\nSET R2 0\nSET R2 0\nLOAD R3 M0\nPRINTLN R3\n",
+        "SET R1 7\nSTORE M0 R1\n"
+    };
+    Computer machine = test::computer(REGISTERS, MEMORY);
+
+    std::vector<std::function<std::shared_ptr<SchedulingAlgorithm>()>>
+        algorithms = {
+        []() { return createRRScheduling(1); },
+        []() { return createMLFQScheduling(1, 2); },
+        []() { return createCFSScheduling(2, 1); },
+    };
+    for(const auto &algorithm : algorithms) {
+        auto plain = test::execute(machine, algorithm(),
+                                   options(false, false), programs);
+        auto optimized = test::execute(machine, algorithm(),
+                                       options(true, false), programs);
+        CHECK(plain.printed(0) == std::vector<number_type>{7});
+        CHECK(optimized == plain);
+    }
+
+    std::mt19937 random{2018};
+    for(unsigned round = 0; round < 200; ++round) {
+        std::list<std::string> programs;
+        for(unsigned i = 0; i < 3; ++i)
+            programs.push_back(test::randomProgram(random, 30, REGISTERS,
+                                                   MEMORY, true));
+
+        time_type quantum = 1 + round % 4;
+        auto plain = test::execute(machine, createRRScheduling(quantum),
+                                   options(false, true), programs);
+        auto optimized = test::execute(machine, createRRScheduling(quantum),
+                                       options(true, true), programs);
+        CHECK(optimized == plain);
+    }
+}
+
+// The programs on the other cores could see the difference too
+void multicore() {
+    std::list<std::string> programs = {"SET R1 1\nSET R1 2\nPRINTLN R1\n"};
+    Computer machine = test::computer(REGISTERS, MEMORY, 2);
+    auto plain = test::execute(machine, createFCFSScheduling(),
+                               options(false, false), programs);
+    auto optimized = test::execute(machine, createFCFSScheduling(),
+                                   options(true, false), programs);
+    CHECK(optimized == plain);
+}
+
+void objectFiles() {
+    const std::string path = "optimizer_test.obj";
+    std::list<std::string> paths = {path};
+
+    Computer fcfs = test::computer(REGISTERS, MEMORY);
+    auto os = fcfs.installOS(createFCFSScheduling());
+    os->setCompilationOptions(options(true, false));
+    os->assembleToFile("SET R1 1\nSET R1 2\nPRINTLN R1\n", path);
+    os->setOutput(std::make_shared<CapturedOutput>());
+    os->executeObjectFiles(paths);
+
+    Computer rr = test::computer(REGISTERS, MEMORY);
+    os = rr.installOS(createRRScheduling(1));
+    bool rejected = false;
+    try {
+        os->executeObjectFiles(paths);
+    }
+    catch(const InvalidObjectException&) {
+        rejected = true;
+    }
+    CHECK(rejected);
+    std::remove(path.c_str());
+}
+} // namespace
+
+int main() {
+    sequential();
+    preemptive();
+    multicore();
+    objectFiles();
+    return test::finish();
+}
@@ -0,0 +1,79 @@
+// The order the scheduling algorithms run the processes in. Every program
+// only prints, one value per cycle, so the processes which printed the
+// values tell the order.
+#include <list>
+#include <string>
+#include "test.h"
+
+namespace {
+std::string prints(unsigned count) {
+    std::string code;
+    for(unsigned i = 0; i < count; ++i)
+        code += "PRINTLN R1\n";
+    return code;
+}
+
+// The processes which printed the values, one digit each
+std::string order(std::shared_ptr<SchedulingAlgorithm> scheduling,
+                  const std::list<std::string> &programs) {
+    auto outcome = test::execute(test::computer(2, 4), scheduling,
+                                 CompilationOptions{}, programs);
+    CHECK(outcome.error.empty());
+
+    std::string result;
+    for(const auto &line : outcome.lines)
+        result += std::to_string(line.first);
+    return result;
+}
+
+// The shortest estimate first, the loop counted as many iterations, the
+// ties in the order of the list
+void sjf() {
+    std::list<std::string> programs = {
+        prints(10), prints(3),
+        "SET R2 1\nloop: PRINTLN R1\nSUB R2 R2\nJNZ R2 loop\n", prints(3)
+    };
+    CHECK(order(createSJFScheduling(), programs) == "1113330000000000" "2");
+}
+
+// Every level doubles the quantum, the processes which finish early do
+// not move down
+void mlfqDemotion() {
+    std::list<std::string> programs = {prints(12), prints(3), prints(7)};
+    CHECK(order(createMLFQScheduling(2, 3), programs)
+          == "00" "11" "22" "0000" "1" "2222" "000000" "2");
+}
+
+// Only the time the processes were executed for counts towards the boost,
+// the ones which finish early use up less than their quantum
+void mlfqBoost() {
+    std::list<std::string> programs = {
+        prints(20), prints(1), prints(1), prints(1), prints(12)
+    };
+    CHECK(order(createMLFQScheduling(2, 3, 8), programs)
+          == "00" "1" "2" "3" "44" "0000" "44" "00" "4444" "00" "44" "0000"
+             "44" "00" "0000");
+}
+
+// The latency is split evenly between the unfinished processes, the least
+// executed one goes first
+void cfs() {
+    std::list<std::string> programs = {prints(8), prints(16), prints(16)};
+    CHECK(order(createCFSScheduling(12, 2), programs)
+          == "0000" "1111" "2222" "0000" "111111" "222222" "111111"
+             "222222");
+
+    // No slice is shorter than the granularity
+    programs = {prints(6), prints(6), prints(6), prints(6)};
+    CHECK(order(createCFSScheduling(4, 3), programs)
+          == "000" "111" "222" "333" "000" "111" "222" "333");
+}
+} // namespace
+
+int main() {
+    sjf();
+    mlfqDemotion();
+    mlfqBoost();
+    cfs();
+    return test::finish();
+}
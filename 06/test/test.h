@@ -0,0 +1,237 @@
+// The helpers shared by the tests of the emulator. Every test is a program
+// of its own, built together with the sources of the computer, e.g.
+//
+//     g++ -std=c++11 -O2 -pthread -I.. ../*.cc optimizer_test.cc -o test
+//
+// It prints the checks which failed and exits with a non-zero status if
+// there were any.
+#ifndef _TEST_H
+#define _TEST_H
+
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+#include "computer.h"
+#include "output.h"
+
+#define CHECK(condition) \
+    test::check((condition), #condition, __FILE__, __LINE__)
+
+namespace test {
+unsigned failures = 0;
+
+inline void check(bool passed, const char *condition, const char *file,
+                  int line) {
+    if(passed)
+        return;
+    ++failures;
+    std::cerr << file << ':' << line << ": failed " << condition << std::endl;
+}
+
+inline int finish() {
+    if(failures > 0)
+        std::cerr << failures << " checks failed" << std::endl;
+    return failures > 0;
+}
+
+// The type and the message of the exception, empty for null
+inline std::string describe(std::exception_ptr error) {
+    if(!error)
+        return "";
+    try {
+        std::rethrow_exception(error);
+    }
+    catch(const std::exception &exception) {
+        return std::string(typeid(exception).name()) + ": " + exception.what();
+    }
+    catch(...) {
+        return "unknown exception";
+    }
+}
+
+// What a run of the programs has shown
+struct Outcome {
+    // The values in the order they were printed
+    std::vector<std::pair<pid_type, number_type>> lines;
+    // The exception thrown by the run, see describe()
+    std::string error;
+    std::vector<uint64_t> cycles;
+
+    // The values printed by the process
+    std::vector<number_type> printed(pid_type process) const {
+        std::vector<number_type> result;
+        for(const auto &line : lines)
+            if(line.first == process)
+                result.push_back(line.second);
+        return result;
+    }
+
+    bool operator==(const Outcome &that) const {
+        return lines == that.lines && error == that.error
+            && cycles == that.cycles;
+    }
+
+    bool operator!=(const Outcome &that) const {
+        return !(*this == that);
+    }
+};
+
+// Installs the OS on a copy of the computer and runs the programs on it
+inline Outcome execute(const Computer &machine,
+                       std::shared_ptr<SchedulingAlgorithm> scheduling,
+                       const CompilationOptions &options,
+                       const std::list<std::string> &programs) {
+    Outcome outcome;
+    Computer computer{machine};
+    auto os = computer.installOS(scheduling);
+    os->setCompilationOptions(options);
+    os->setOutput(std::make_shared<CallbackOutput>(
+        [&outcome](pid_type process, number_type value) {
+            outcome.lines.emplace_back(process, value);
+        }));
+
+    try {
+        os->executePrograms(programs);
+    }
+    catch(...) {
+        outcome.error = describe(std::current_exception());
+    }
+    outcome.cycles = os->processCycles();
+    return outcome;
+}
+
+// A random program for a machine with the registers (at least three) and
+// the memory cells, made of about the given number of instructions. It has
+// forward jumps and bounded loops: the last register counts the iterations
+// and the one before it holds one, the loops never write them. The faulty
+// programs may divide by zero and use the operands out of range.
+inline std::string randomProgram(std::mt19937 &random, unsigned length,
+                                 register_type registers, memory_type memory,
+                                 bool faulty) {
+    register_type counter = registers;
+    register_type one = registers - 1;
+    auto pick = [&random](unsigned count) {
+        return static_cast<unsigned>(random() % count);
+    };
+    auto reg = [&]() {
+        if(faulty && pick(60) == 0)
+            return "R" + std::to_string(registers + 1);
+        return "R" + std::to_string(pick(registers) + 1);
+    };
+    auto target = [&]() {
+        return "R" + std::to_string(pick(registers - 2) + 1);
+    };
+    auto cell = [&]() {
+        if(faulty && pick(60) == 0)
+            return "M" + std::to_string(memory);
+        return "M" + std::to_string(pick(memory));
+    };
+    auto number = [&]() {
+        static const number_type large[] = {
+            1 << 30, -(1 << 30), 2147483646, -2147483645, 65536
+        };
+        return std::to_string(pick(8) ? static_cast<number_type>(pick(21)) - 10
+                                      : large[pick(5)]);
+    };
+
+    std::ostringstream code;
+    code << "SET R" << one << " 1\n";
+    unsigned labels = 0;
+    // The forward jumps not landed yet, closed before the loops start or end
+    std::vector<std::string> pending;
+    auto land = [&code, &pending]() {
+        for(const auto &label : pending)
+            code << label << ":\n";
+        pending.clear();
+    };
+    // The label of the loop being generated and the instructions left in
+    // it, empty if there is none
+    std::string loop;
+    unsigned body = 0;
+
+    for(unsigned i = 0; i < length; ++i) {
+        if(!loop.empty() && body-- == 0) {
+            land();
+            code << "SUB R" << counter << " R" << one << "\nJGZ R" << counter
+                 << ' ' << loop << '\n';
+            loop.clear();
+        }
+
+        static const char *conditions[] = {"JZ", "JNZ", "JGZ", "JLZ"};
+        switch(pick(16)) {
+            case 0:
+            case 1:
+                code << "SET " << target() << ' ' << number() << '\n';
+                break;
+            case 2:
+                code << "LOAD " << target() << ' ' << cell() << '\n';
+                break;
+            case 3:
+                code << "STORE " << cell() << ' ' << reg() << '\n';
+                break;
+            case 4:
+            case 5:
+                code << "ADD " << target() << ' ' << reg() << '\n';
+                break;
+            case 6:
+                code << "SUB " << target() << ' ' << reg() << '\n';
+                break;
+            case 7:
+                code << "MUL " << target() << ' ' << reg() << '\n';
+                break;
+            case 8:
+                code << "DIV " << target() << ' '
+                     << (faulty && pick(3) == 0 ? reg() : "R"
+                         + std::to_string(one)) << '\n';
+                break;
+            case 9:
+            case 10:
+                code << "PRINTLN " << reg() << '\n';
+                break;
+            case 11:
+                pending.push_back("S" + std::to_string(labels++));
+                code << conditions[pick(4)] << ' ' << reg() << ' '
+                     << pending.back() << '\n';
+                break;
+            case 12:
+                if(loop.empty()) {
+                    land();
+                    loop = "L" + std::to_string(labels++);
+                    body = pick(8) + 1;
+                    code << "SET R" << counter << ' ' << pick(5) << '\n'
+                         << loop << ":\n";
+                }
+                break;
+            default:
+                land();
+                break;
+        }
+    }
+
+    if(!loop.empty()) {
+        land();
+        code << "SUB R" << counter << " R" << one << "\nJGZ R" << counter
+             << ' ' << loop << '\n';
+    }
+    land();
+    return code.str();
+}
+
+inline Computer computer(register_type registers, memory_type memory,
+                         unsigned cores = 1) {
+    Computer result;
+    result.setCPU(registers, cores);
+    result.setRAM(memory);
+    return result;
+}
+} // namespace test
+
+#endif // _TEST_H
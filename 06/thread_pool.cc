@@ -0,0 +1,133 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace computer_internal {
+ThreadPool::ThreadPool(unsigned threads) : queued{0}, stopping{false} {
+    threads = std::max(threads, 1u);
+
+    for(unsigned i = 0; i < threads; ++i)
+        queues.emplace_back(new Queue{});
+
+    for(unsigned i = 0; i < threads; ++i)
+        workers.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard{lock};
+        stopping = true;
+    }
+    wakeup.notify_all();
+
+    for(auto &worker : workers)
+        worker.join();
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+unsigned ThreadPool::size() const {
+    return queues.size();
+}
+
+bool ThreadPool::take(std::size_t queue, Task &task) {
+    for(std::size_t i = 0; i < queues.size(); ++i) {
+        Queue &victim = *queues[(queue + i) % queues.size()];
+        std::lock_guard<std::mutex> guard{victim.lock};
+        if(victim.tasks.empty())
+            continue;
+
+        if(i == 0) { // our own queue
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+        }
+        else {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+
+        --queued;
+        return true;
+    }
+
+    return false;
+}
+
+void ThreadPool::execute(Task &task) {
+    std::exception_ptr error;
+    try {
+        task.function();
+    }
+    catch(...) {
+        error = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> guard{lock};
+    Batch &batch = *task.batch;
+    // Moved, so that the thread rethrowing the exception is the last one
+    // to hold it
+    if(error && (!batch.error || task.index < batch.error_index)) {
+        batch.error = std::move(error);
+        batch.error_index = task.index;
+    }
+
+    // The batch may be gone as soon as the lock is released
+    if(--batch.left == 0)
+        wakeup.notify_all();
+}
+
+void ThreadPool::work(std::size_t queue) {
+    while(true) {
+        Task task;
+        if(take(queue, task)) {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard{lock};
+        wakeup.wait(guard, [this]() { return stopping || queued > 0; });
+        if(stopping && queued == 0)
+            return;
+    }
+}
+
+void ThreadPool::run(std::vector<task_type> tasks) {
+    if(tasks.empty())
+        return;
+
+    Batch batch{tasks.size(), {}, 0};
+    {
+        // Counted in advance, so that the counter never drops below zero
+        std::lock_guard<std::mutex> guard{lock};
+        queued += tasks.size();
+    }
+
+    for(std::size_t i = 0; i < tasks.size(); ++i) {
+        Queue &queue = *queues[i % queues.size()];
+        std::lock_guard<std::mutex> guard{queue.lock};
+        queue.tasks.push_back({std::move(tasks[i]), &batch, i});
+    }
+    wakeup.notify_all();
+
+    while(true) {
+        Task task;
+        if(take(0, task)) {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard{lock};
+        wakeup.wait(guard, [this, &batch]() {
+            return batch.left == 0 || queued > 0;
+        });
+        if(batch.left == 0)
+            break;
+    }
+
+    if(batch.error)
+        std::rethrow_exception(batch.error);
+}
+} // namespace computer_internal
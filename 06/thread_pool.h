@@ -0,0 +1,75 @@
+#ifndef _THREAD_POOL_H
+#define _THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace computer_internal {
+// A work-stealing thread pool. Every worker takes the most recently queued
+// tasks from its own queue and, once it runs dry, steals the oldest ones
+// from the other workers.
+class ThreadPool {
+    public:
+    using task_type = std::function<void()>;
+
+    private:
+    struct Batch {
+        std::size_t left;
+        std::exception_ptr error;
+        std::size_t error_index;
+    };
+
+    struct Task {
+        task_type function;
+        Batch *batch;
+        std::size_t index;
+    };
+
+    struct Queue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    // Guards the batches and is used to wait for the work
+    std::mutex lock;
+    std::condition_variable wakeup;
+    std::atomic<std::size_t> queued;
+    bool stopping;
+
+    // Takes a task from the given queue or steals one from the others
+    bool take(std::size_t queue, Task &task);
+    void execute(Task &task);
+    void work(std::size_t queue);
+
+    public:
+    // Sized to the host by default
+    explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency());
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    unsigned size() const;
+
+    // The pool shared by all the computers, created on the first use
+    static ThreadPool& shared();
+
+    // Runs the tasks and waits until all of them are finished, the calling
+    // thread takes part in the work (so the tasks may use the pool too). If
+    // any of the tasks throws, the exception thrown by the first of them
+    // (in the order of the vector) is rethrown.
+    void run(std::vector<task_type> tasks);
+};
+} // namespace computer_internal
+
+#endif // _THREAD_POOL_H